@@ -0,0 +1,102 @@
+#include <avr/interrupt.h>
+#include "Capture.h"
+
+Capture::Capture(Hal& hal) :
+  _hal(hal),
+  _ring(),
+  _head(0),
+  _size(0),
+  _serial(NO_SERIAL),
+  _time(0),
+  _reason(0)
+{}
+
+void Capture::add(byte kind, byte value) {
+  if (_reason != 0)
+    return;
+  byte sreg = SREG;
+  cli();
+  begin(kind);
+  put(value);
+  SREG = sreg;
+}
+
+void Capture::add(byte kind, int value) {
+  if (_reason != 0)
+    return;
+  byte sreg = SREG;
+  cli();
+  begin(kind);
+  put(value);
+  put(value >> 8);
+  SREG = sreg;
+}
+
+void Capture::addSerial(char ch) {
+  if (_reason != 0)
+    return;
+  byte sreg = SREG;
+  cli();
+  if (_serial != NO_SERIAL && (_ring[_serial] & MAX_SERIAL) != MAX_SERIAL && _hal.millis() - _time < SERIAL_MERGE)
+    _ring[_serial]++; // one more byte in the last record
+  else {
+    unsigned int pos = _head;
+    begin(SERIAL | 1);
+    _serial = pos;
+  }
+  put(ch);
+  SREG = sreg;
+}
+
+void Capture::freeze(char reason) {
+  if (_reason == 0)
+    _reason = reason;
+}
+
+void Capture::rearm() {
+  _serial = NO_SERIAL;
+  _reason = 0;
+}
+
+void Capture::write(Print& out) {
+  unsigned int tail = _head >= _size ? _head - _size : _head + SIZE - _size;
+  if (tail + _size <= SIZE)
+    out.write(&_ring[tail], _size);
+  else {
+    out.write(&_ring[tail], SIZE - tail);
+    out.write(&_ring[0], _head);
+  }
+}
+
+// Writes kind byte and time since the previous record
+void Capture::begin(byte kind) {
+  unsigned long now = _hal.millis();
+  unsigned long dt = min(now - _time, MAX_DT);
+  _time = now;
+  _serial = NO_SERIAL;
+  put(kind);
+  while (dt > 0x7f) {
+    put(0x80 | (dt & 0x7f));
+    dt >>= 7;
+  }
+  put(dt);
+}
+
+inline void Capture::put(byte b) {
+  if (_size == SIZE)
+    drop();
+  _ring[_head] = b;
+  if (++_head == SIZE)
+    _head = 0;
+  _size++;
+}
+
+// Drops the oldest record, the ring is larger than a few records, so it is never the one being written
+void Capture::drop() {
+  unsigned int tail = _head >= _size ? _head - _size : _head + SIZE - _size;
+  byte kind = _ring[tail];
+  unsigned int n = 1;
+  while (_ring[(tail + n) % SIZE] & 0x80)
+    n++; // more bytes of dt
+  _size -= n + 1 + payloadSize(kind);
+}
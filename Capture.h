@@ -0,0 +1,108 @@
+/**
+ * Ring of the most recent inputs consumed by the control logic for post-mortem replay: serial bytes
+ * the parser consumed, scanned state changes, changed raw sensor reads, and analog inputs. Each record
+ * is a kind byte, ms since the previous record in 1 to 3 bytes (7 bits each, low bits first, the high
+ * bit is set when more follow), and its payload. Serial bytes that arrive together share a record,
+ * traffic that the parser skips between commands is not recorded. The ring is frozen on the first
+ * error or reset signal, so it keeps the inputs that led to it, and it is re-armed after it was
+ * dumped. host/replay -x feeds a dump back to the firmware.
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <Arduino.h>
+#include "Hal.h"
+#include "profile.h"
+
+class Capture {
+public:
+  static const unsigned int SIZE = Profile::CAPTURE_SIZE; // bytes of records
+  static const unsigned long MAX_DT = 0x1fffff;           // longer gaps between records are shortened (ms)
+  static const byte SERIAL_MERGE = 10;                    // serial bytes within it share a record (ms)
+
+  // Record kinds in the high nibble of the kind byte, the low nibble keeps a count or an index
+  static const byte KIND_MASK = 0xf0;
+  static const byte SERIAL    = 0x10; // count (1 to 15) of serial bytes follow
+  static const byte STATE     = 0x20; // scanned state bits (before error debouncing) follow
+  static const byte TEMP      = 0x30; // changed raw sensor read in 1/16 deg C follows (int), index is the sensor
+  static const byte ANALOG    = 0x40; // analog input follows (int), index is ANALOG_xxx
+
+  static const byte MAX_SERIAL = 0x0f;
+  static const int  NO_TEMP    = 0x7fff; // TEMP of failed read
+
+
+  static const byte ANALOG_PRESET_TEMP = 0;
+  static const byte ANALOG_PRESET_TIME = 1;
+  static const byte ANALOG_TURNED_ON   = 2;
+
+  Capture(Hal& hal);
+
+  /** Records event with one byte payload unless frozen, it is safe to call from interrupt handlers. */
+  void add(byte kind, byte value);
+
+  /** Records event with int payload (low byte first) unless frozen, it is safe to call from interrupt handlers. */
+  void add(byte kind, int value);
+
+  /** Records serial byte consumed by the parser unless frozen. */
+  void addSerial(char ch);
+
+  /** Stops recording and keeps the reason, does nothing when already frozen. */
+  void freeze(char reason);
+
+  /** Resumes recording. */
+  void rearm();
+
+  unsigned int size();   // bytes of records
+  void write(Print& out); // writes records, the oldest first
+  char reason();         // reason of freeze or zero
+  unsigned long time();  // time of the last record
+
+  static byte payloadSize(byte kind);
+
+private:
+  static const unsigned int NO_SERIAL = 0xffff;
+
+  Hal&          _hal;
+  byte          _ring[SIZE];
+  unsigned int  _head;   // next byte to write
+  unsigned int  _size;
+  unsigned int  _serial; // kind byte of the last record when it is SERIAL, NO_SERIAL otherwise
+  unsigned long _time;
+  volatile char _reason;
+
+  void begin(byte kind);
+  void put(byte b);
+  void drop();
+
+  Capture(const Capture& other); // no copy constructor
+};
+
+static_assert(Capture::SIZE >= 64, "capture ring must hold several records of the longest kind");
+
+inline unsigned int Capture::size() {
+  return _size;
+}
+
+inline char Capture::reason() {
+  return _reason;
+}
+
+inline unsigned long Capture::time() {
+  return _time;
+}
+
+inline byte Capture::payloadSize(byte kind) {
+  switch (kind & KIND_MASK) {
+  case SERIAL:
+    return kind & MAX_SERIAL;
+  case STATE:
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+extern Capture capture; // of the board, the *_hal.cpp modules and ds18b20.cpp record into it
+
+#endif
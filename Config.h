@@ -7,6 +7,7 @@
 #include "FixNum.h"
 #include "TempZones.h"
 #include "Force.h"
+#include "ds18b20.h"
 #include "state_hal.h"
 
 class Config {
@@ -30,6 +31,12 @@ public:
     Byte<temp_t> tempP;
     Byte<temp_t> _reserved3;
   };
+
+  class Sensor {
+  public:
+    Byte<byte> rom[DS18B20::ROM_SIZE]; // 1-Wire ROM code, family code first
+    Byte<byte> zone;                   // TempZones index or DS18B20::NO_ZONE
+  };
   
   Byte<byte>        _reserved0;
   Byte<State::Mode> mode;       // see state_hal.h enum State::Mode 
@@ -37,11 +44,15 @@ public:
   Byte<byte>        period;     // minimal period between activations (minutes)
   Byte<byte>        duration;   // minimal activation duration (minutes)
   Byte<byte>        hotwater;   // max hotwater time (minutes)
-  Byte<byte>        _reserved6;
-  Byte<byte>        _reserved7;
-  Byte<byte>        _reserved8;
-  Byte<byte>        _reserved9;
-  Zone              zone[TempZones::N_ZONES];
+  Byte<byte>        corridor;   // history recorder corridor (1/100 deg C), 0 or 0xff to disable (or default on the lean profile)
+  Byte<byte>        reportMin;  // adaptive reporting min interval (seconds)
+  Byte<byte>        reportMax;  // adaptive reporting max interval (minutes)
+  Byte<temp_t>      reportTemp; // adaptive reporting temperature change, invalid to report every minute
+  Byte<byte>        slotNode;   // slot number of this controller in reporting cycle
+  Byte<byte>        slotCount;  // number of slots in reporting cycle, slotted reporting is on when slotNode < slotCount
+  Byte<byte>        reportSeq;  // 1 to append report sequence numbers to state dumps (see ReportLog)
+  Zone              zone[TempZones::N_ZONES];   // arrays are sized by the profile, so they go last
+  Sensor            sensor[DS18B20::MAX_SENSORS];
 };
 
 template<class T> Config::Byte<T>::Byte() {} // default constructor is empty
@@ -0,0 +1,458 @@
+#include "Controller.h"
+#include "Usage.h"
+#include "Recorder.h"
+#include "ReportLog.h"
+#include "Slots.h"
+#include "Capture.h"
+#include "xprint.h"
+#include "parse.h"
+#include "dump.h"
+
+//------- ALL TIME DEFS ------
+
+const long INITIAL_DUMP_INTERVAL   = 2000L;  // 2 sec
+const long PERIODIC_DUMP_INTERVAL  = 60000L; // 1 min
+const long PERIODIC_DUMP_SKEW      = 5000L;  // 5 sec
+
+const Controller::ResetLimits Controller::DEFAULT_RESET_LIMITS = {
+  180000L, // wait 3 min
+  50,      // reset when working for 50 mins
+  -10,     // ... and loosing 0.1 deg C/hour or more
+  2100     // ... and temparature is below +21 deg C
+};
+
+const int MAX_WORK_MINUTES = 60;
+const long HISTORY_INTERVAL = Profile::HISTORY_INTERVAL;
+const byte SAMPLES_PER_HOUR = Profile::SAMPLES_PER_HOUR;
+const byte TREND_MINUTES[] = { 5, 15, 60, 180 };
+
+//------- DUMP LINE -------
+
+const char HIGHLIGHT_CHAR = '*';
+
+// State dump line has fixed width fields:
+//   "[C:0 +??.? e0o0z0;s0000000 d+0.00p00.0q0.0w00i000-0.0a000+0.0u00000000#00000]*"
+// Zone after 'z' is a single digit ("z7") when the profile has up to 10 zones, so the line of the lean
+// boards stays as the gateways know it, and two digits ("z07") on large boards, so that zones up to 63 fit.
+// The sequence number ("#00000") is there only when the gateway opted in with config.reportSeq.
+
+const byte ZONE_SIZE = Profile::N_ZONES <= 10 ? 1 : 2;
+const byte SEQ_SIZE  = 5;
+
+typedef FixNum<int, 1> temp1_t;
+
+inline temp1_t temp1(Sensor::temp_t x) {
+  return x;
+}
+
+//------- CONTROLLER -------
+
+Controller::Controller(Hal& hal, Print& out, Sensor& sensor, Config& config, TempZones& zones, Force& force,
+    Recorder& recorder, ReportLog& reportLog, Slots& slots, Usage& usage, Capture& capture,
+    const ResetLimits& resetLimits) :
+  _hal(hal),
+  _out(out),
+  _sensor(sensor),
+  _config(config),
+  _zones(zones),
+  _force(force),
+  _recorder(recorder),
+  _reportLog(reportLog),
+  _slots(slots),
+  _usage(usage),
+  _capture(capture),
+  _inactiveStartMillis(0),
+  _inactiveStartTemp(),
+  _inactiveDt(0),
+  _inactiveMinutes(0),
+  _activeStartMillis(0),
+  _activeStartTemp(),
+  _activeDt(0),
+  _activeMinutes(0),
+  _wasInactive(false),
+  _wasActive(false),
+  _trend(),
+  _h(),
+  _hHead(0),
+  _hTail(0),
+  _hSize(0),
+  _hSumWork(0),
+  _hWorkMinutes(0),
+  _hDeltaTemp(0),
+  _hTimeout(0, HISTORY_INTERVAL),
+  _firstDump(true),
+  _dumpTimeout(0, INITIAL_DUMP_INTERVAL),
+  _lastDumpTime(0),
+  _lastDumpTemp(),
+  _lastDumpState(0),
+  _lastDumpZone(0),
+  _daystart(0),
+  _updays(0),
+  _prevMode(State::MODE_UNKNOWN),
+  _wasError(false),
+  _resetLimits(resetLimits),
+  _lastResetConditionTime(0),
+  _lastOkConditionTime(0),
+  _resetConditionWaitInterval(resetLimits.waitInterval)
+{
+  static_assert(N_TRENDS <= sizeof(TREND_MINUTES), "trend window is not defined");
+  static_assert(MAX_HISTORY == 0 || MAX_HISTORY > SAMPLES_PER_HOUR, "raw history shall be longer than an hour");
+  for (byte i = 0; i < N_TRENDS; i++)
+    _trend[i] = Trend(TREND_MINUTES[i] * SAMPLES_PER_HOUR / 60, SAMPLES_PER_HOUR);
+}
+
+void Controller::check() {
+  checkInactive();
+  updateMode();
+  saveHistory();
+  checkError();
+  checkReset();
+  dumpState();
+}
+
+//------- CHECK ACTIVE/INACTIVE TIME/TEMP -------
+
+void Controller::checkInactive() {
+  unsigned long time = _hal.millis();
+  boolean active = _hal.activeBits() != 0;
+  Sensor::temp_t temp = _sensor.value();
+  if (!temp.valid())
+    return;
+  if (!_wasInactive && !active) {
+    _inactiveStartMillis = time;
+    _inactiveStartTemp = temp;
+  }
+  if (!active) {
+    _inactiveMinutes = (time - _inactiveStartMillis) / 60000L;
+    _inactiveDt = temp - _inactiveStartTemp;
+  }
+  if (!_wasActive && active) {
+    _activeStartMillis = time;
+    _activeStartTemp = temp;
+  }
+  if (active) {
+    _activeMinutes = (time - _activeStartMillis) / 60000L;
+    _activeDt = temp - _activeStartTemp;
+  }
+  _wasInactive = !active;
+  _wasActive = active;
+}
+
+//------- STATE HISTORY -------
+
+void Controller::saveHistory() {
+  // note: only save history with valid temperature measurements
+  Sensor::temp_t temp = _sensor.value();
+  if (!temp.valid())
+    return;
+  unsigned long now = _hal.millis();
+  if (_hTimeout.check(now)) {
+    _hTimeout.reset(now, HISTORY_INTERVAL);
+    byte work = _hal.activeBits() != 0 ? 1 : 0;
+    _recorder.add(work, temp);
+    if (MAX_HISTORY != 0)
+      saveRawHistory(work, temp);
+    else
+      readRecordedHistory(temp);
+  }
+}
+
+// Index of the sample that was added n samples before the one at tail
+inline unsigned int Controller::historyBack(unsigned int n) {
+  return _hTail >= n ? _hTail - n : _hTail + MAX_HISTORY - n;
+}
+
+void Controller::saveRawHistory(byte work, Sensor::temp_t temp) {
+  // update trends and stats with samples falling out of their windows (before tail is overwritten)
+  for (byte i = 0; i < N_TRENDS; i++)
+    _trend[i].add(temp, _h[historyBack(_trend[i].size())].temp);
+  _hSumWork += work;
+  if (_hSize >= SAMPLES_PER_HOUR)
+    _hSumWork -= _h[historyBack(SAMPLES_PER_HOUR)].work;
+  _hSize++;
+  // enqueue to tail
+  _h[_hTail].work = work;
+  _h[_hTail].temp = temp;
+  // recompute stats over the last hour
+  unsigned int n = min(_hSize, (unsigned int)SAMPLES_PER_HOUR);
+  _hWorkMinutes = _hSumWork * MAX_WORK_MINUTES / n;
+  _hDeltaTemp = temp - _h[historyBack(n - 1)].temp;
+  // move queue tail
+  _hTail++;
+  if (_hTail == MAX_HISTORY)
+    _hTail = 0;
+  if (_hTail == _hHead) {
+    _hHead++;
+    if (_hHead == MAX_HISTORY)
+      _hHead = 0;
+    _hSize--;
+  }
+}
+
+// Recomputes stats and trends over the last hour of samples restored from the recorder. Incremental
+// trends would drift here, as the samples falling out of their windows are restored only within the
+// corridor. It takes a few hundred multiplications and divisions once per history interval.
+void Controller::readRecordedHistory(Sensor::temp_t temp) {
+  unsigned int samples = _recorder.samples();
+  unsigned int n = min(samples, (unsigned int)SAMPLES_PER_HOUR);
+  Recorder::Reader reader(_recorder);
+  reader.skip(samples - n);
+  for (byte i = 0; i < N_TRENDS; i++)
+    _trend[i].clear();
+  int sumWork = 0;
+  for (unsigned int p = 0; p < n; p++) {
+    byte work;
+    Sensor::temp_t t;
+    reader.next(work, t);
+    if (p == 0)
+      _hDeltaTemp = temp - t;
+    sumWork += work;
+    for (byte i = 0; i < N_TRENDS; i++)
+      if (n - p <= _trend[i].size())
+        _trend[i].add(t, t);
+  }
+  _hWorkMinutes = sumWork * MAX_WORK_MINUTES / n;
+}
+
+//------- DUMP STATE -------
+
+// Adaptive interval is the time to change by config.reportTemp at the current 5 min slope
+long Controller::nextDumpInterval() {
+  Config::temp_t delta = _config.reportTemp.read();
+  if (!delta.valid())
+    return PERIODIC_DUMP_INTERVAL; // adaptive reporting is off
+  long minInterval = _config.reportMin.read() * Timeout::SECOND;
+  long maxInterval = _config.reportMax.read() * Timeout::MINUTE;
+  long interval = maxInterval;
+  Sensor::temp_t slope = _trend[0].slope();
+  Sensor::temp_t d = delta;
+  if (slope.valid() && slope.mantissa() != 0) {
+    long seconds = d.mantissa() * 3600L / abs(slope.mantissa());
+    if (seconds < maxInterval / (long)Timeout::SECOND)
+      interval = seconds * Timeout::SECOND;
+  }
+  return max(interval, minInterval + PERIODIC_DUMP_SKEW);
+}
+
+void Controller::makeDump(char dumpType) {
+  // atomically read everything
+  noInterrupts();
+  byte mode = _hal.mode();
+  byte state = _hal.state();
+  interrupts();
+
+  // count uptime
+  unsigned long time = _hal.millis();
+  while (time - _daystart > Timeout::DAY) {
+    _daystart += Timeout::DAY;
+    _updays++;
+  }
+  time -= _daystart;
+  time /= 1000; // convert seconds
+
+  // store for backfill
+  Sensor::temp_t temp = _sensor.value();
+  byte zone = _force.getForcedZone();
+  unsigned int seq = _reportLog.add(dumpType, mode, state, temp, zone);
+
+  // print state, other stuff, presets, and uptime into one line
+  _hal.waitPrint();
+  {
+    FmtLine line(_out);
+    printFmtOn_C(line, "[C:% % e%o%z%;s% d%", mode, FmtArg::fixed(temp1(temp), 5),
+      FmtArg::fixed(_hal.errorBits(), 1), FmtArg::fixed(_hal.activeBits(), 1), FmtArg::fixed(zone, ZONE_SIZE),
+      FmtArg::bits(state, STATE_SIZE), FmtArg::fixed(_hDeltaTemp, 5));
+    printFmtOn_C(line, "p%q%w%i%%a%%", FmtArg::fixed(_hal.presetTemp(), 4, 1), FmtArg::fixed(_hal.presetTime(), 3, 1),
+      FmtArg::fixed(_hWorkMinutes, 2), FmtArg::fixed(_inactiveMinutes, 3), FmtArg::fixed(temp1(_inactiveDt), 4),
+      FmtArg::fixed(_activeMinutes, 3), FmtArg::fixed(temp1(_activeDt), 4));
+    printFmtOn_C(line, "u%%%%", FmtArg::fixed(_updays, 2), FmtArg::fixed(time / 3600, 2),
+      FmtArg::fixed(time / 60 % 60, 2), FmtArg::fixed(time % 60, 2));
+    if (_config.reportSeq.read() == 1)
+      printFmtOn_C(line, "#%", FmtArg::fixed(seq, SEQ_SIZE));
+    line.print(']');
+    if (dumpType != DUMP_REGULAR) {
+      line.print(dumpType);
+      if (dumpType != HIGHLIGHT_CHAR)
+        line.print(HIGHLIGHT_CHAR); // must end with highlight (signal) char
+    }
+    printOn_C(line, "\r\n");
+  } // the line goes out here
+  unsigned long now = _hal.millis();
+  if (_slots.enabled())
+    _dumpTimeout.reset(now, _slots.nextSlot(nextDumpInterval()));
+  else
+    _dumpTimeout.reset(now, nextDumpInterval() + _hal.random(-PERIODIC_DUMP_SKEW, PERIODIC_DUMP_SKEW));
+  _firstDump = false;
+  _lastDumpTime = now;
+  _lastDumpTemp = temp;
+  _lastDumpState = state;
+  _lastDumpZone = zone;
+}
+
+// Returns true when adaptive reporting is on and something has changed enough since the last dump
+boolean Controller::isReportChange() {
+  Config::temp_t delta = _config.reportTemp.read();
+  if (!delta.valid() || _slots.enabled())
+    return false; // not adaptive or must report in own slot
+  if (_hal.millis() - _lastDumpTime < _config.reportMin.read() * Timeout::SECOND)
+    return false;
+  if (_hal.state() != _lastDumpState || _force.getForcedZone() != _lastDumpZone)
+    return true;
+  Sensor::temp_t temp = _sensor.value();
+  if (temp.valid() != _lastDumpTemp.valid())
+    return true;
+  if (!temp.valid())
+    return false;
+  Sensor::temp_t d = delta;
+  return temp - _lastDumpTemp >= d || _lastDumpTemp - temp >= d;
+}
+
+inline void Controller::dumpState() {
+  if (_dumpTimeout.check(_hal.millis()) || isReportChange())
+    makeDump(_firstDump ? DUMP_FIRST : DUMP_REGULAR);
+}
+
+//------- SAVE MODE --------
+
+void Controller::saveMode() {
+  State::Mode mode = _hal.mode(); // atomic read
+  if (mode != 0 && mode != _config.mode.read())
+    _config.mode = mode;
+  _prevMode = mode; // also store as "previous mode" to track updates
+}
+
+//------- EXECUTE COMMANDS -------
+
+void Controller::execute(char cmd) {
+  switch (cmd) {
+  case CMD_DUMP_STATE:
+    makeDump(DUMP_CMD_RESPONSE);
+    break;
+  case CMD_DUMP_CONFIG:
+  case CMD_CONFIG_CHANGED:
+    _hal.waitPrint();
+    makeConfigDump(_out, _config);
+    break;
+  case CMD_DUMP_ZONES:
+    _hal.waitPrint();
+    makeZonesDump(_out, _zones);
+    break;
+  case CMD_DUMP_INFO:
+    _hal.waitPrint();
+    makeInfoDump(_out, _sensor, _zones);
+    break;
+  case CMD_DUMP_TRENDS:
+    _hal.waitPrint();
+    makeTrendsDump(_out, _trend, N_TRENDS);
+    break;
+  case CMD_DUMP_USAGE:
+    _hal.waitPrint();
+    makeUsageDump(_out, _usage);
+    break;
+  case CMD_DUMP_RECORDER:
+    _hal.waitPrint();
+    makeRecorderDump(_out, _recorder);
+    break;
+  case CMD_DUMP_CAPTURE:
+    _hal.waitPrint();
+    makeCaptureDump(_out, _capture);
+    break;
+  case CMD_BEACON:
+    _slots.beacon();
+    break;
+  case '1':
+  case '2':
+  case '3':
+  case '4':
+    _hal.changeMode((State::Mode)(cmd - '0'));
+    saveMode();
+    makeDump(DUMP_CMD_MODE_CHANGE);
+    break;
+  }
+}
+
+//------- UPDATE/RESTORE MODE -------
+
+void Controller::updateMode() {
+  State::Mode mode = _hal.mode(); // read current mode atomically
+  State::Mode savedMode = _config.mode.read();
+  if (mode != 0 && mode != savedMode) {
+    // forbit direct transition from OFF to WORKING
+    if (savedMode == State::MODE_OFF && mode == State::MODE_WORKING) {
+      _hal.changeMode(savedMode);
+      saveMode();
+      makeDump(DUMP_RESTORE_OFF_MODE);
+    } else {
+      // allow all other transitions
+      saveMode();
+      makeDump(DUMP_EXTERNAL_MODE_CHANGE);
+    }
+  } else if (mode != _prevMode) {
+     // transition to zero mode or from zero mode
+    makeDump(mode == 0 ? DUMP_POWER_LOST : DUMP_POWER_BACK);
+    _prevMode = mode;
+  }
+  mode = _hal.mode(); // atomic reread
+  byte hotwaterTimeoutMins = _config.hotwater.read();
+  if (hotwaterTimeoutMins != 0 &&
+      mode == State::MODE_HOTWATER &&
+      _hal.millis() - _hal.modeTime(State::MODE_HOTWATER) > hotwaterTimeoutMins * Timeout::MINUTE)
+  {
+    // HOTWATER mode for too long... switch to WORKING
+    _hal.changeMode(State::MODE_WORKING);
+    saveMode();
+    makeDump(DUMP_HOTWATER_TIMEOUT);
+  }
+}
+
+//------- CHECK ERROR -------
+
+void Controller::checkError() {
+  boolean isError = _hal.errorBits() != 0;
+  if (_wasError != isError) {
+    _wasError = isError;
+    if (isError)
+      _capture.freeze(DUMP_ERROR);
+    makeDump(isError ? DUMP_ERROR : DUMP_NORMAL);
+  }
+}
+
+//------- CHECK FOR RESET -------
+
+boolean Controller::hasResetCondition() {
+  if (_hal.errorBits() != 0)
+    return true; // reset when error
+  Sensor::temp_t temp = _sensor.value();
+  if (_wasActive && _activeMinutes >= _resetLimits.activeMinutes &&
+      _trend[HOUR_TREND].slope() < _resetLimits.tempDrop &&
+      temp.valid() && temp < _resetLimits.tempAbs)
+    return true; // reset when supposed to be working for 30 min, but loosing temperature, and temp is low
+  return false;
+}
+
+void Controller::checkReset() {
+  long now = _hal.millis();
+  if (!hasResetCondition()) {
+    // Ok condition
+    _lastResetConditionTime = 0;
+    if (_lastOkConditionTime == 0) // for a first time after reset condition
+      _lastOkConditionTime = now;
+    else if (now - _lastOkConditionTime > _resetConditionWaitInterval)
+      _resetConditionWaitInterval = _resetLimits.waitInterval; // ok for long enough -- set interval to default
+    return;
+  }
+  // Reset condition
+  if (_lastResetConditionTime == 0) {
+    // for a first time after ok condition
+    _lastResetConditionTime = now;
+    return;
+  }
+  long wasResetConditionInterval = now - _lastResetConditionTime;
+  if (wasResetConditionInterval < _resetConditionWaitInterval)
+    return; // not long enough... wait
+  // long enough -> perform reset
+  _capture.freeze('R');
+  _hal.waitPrint();
+  printOn_C(_out, "!RR\r\n"); // send reset signal
+  _resetConditionWaitInterval *= 2; // next time wait longer
+}
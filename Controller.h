@@ -0,0 +1,147 @@
+#ifndef CONTROLLER_H_
+#define CONTROLLER_H_
+
+#include <Arduino.h>
+#include "Timeout.h"
+#include "Hal.h"
+#include "Config.h"
+#include "Force.h"
+#include "Trend.h"
+#include "Sensor.h"
+#include "state_hal.h"
+#include "profile.h"
+
+class Recorder;
+class ReportLog;
+class Slots;
+class Usage;
+class Capture;
+
+/**
+ * Controller of one heater. It tracks active and inactive periods, keeps history and trends,
+ * follows mode changes, detects errors and reset conditions, and reports state dumps to out.
+ * The heater and the clock are accessed through Hal, and the config, zones, and logs it works
+ * with are passed in, so several controllers with their own instances may run side by side.
+ */
+class Controller {
+public:
+  /** Reset condition thresholds, see checkReset. */
+  struct ResetLimits {
+    long waitInterval;  // time in reset condition before reset (ms), doubles after each reset
+    int  activeMinutes; // reset when working for this long
+    int  tempDrop;      // ... and hour trend is below this (1/100 deg C per hour)
+    int  tempAbs;       // ... and temperature is below this (1/100 deg C)
+  };
+
+  static const ResetLimits DEFAULT_RESET_LIMITS;
+
+  static const char DUMP_REGULAR              = 0;
+  static const char DUMP_FIRST                = '*';
+  static const char DUMP_EXTERNAL_MODE_CHANGE = 'b';
+  static const char DUMP_RESTORE_OFF_MODE     = 'r';
+  static const char DUMP_HOTWATER_TIMEOUT     = 'h';
+  static const char DUMP_CMD_RESPONSE         = '?';
+  static const char DUMP_CMD_MODE_CHANGE      = 'c';
+  static const char DUMP_POWER_LOST           = '0';
+  static const char DUMP_POWER_BACK           = '1';
+  static const char DUMP_ERROR                = 'e';
+  static const char DUMP_NORMAL               = 'n';
+  static const char DUMP_FORCED_ON            = 'f';
+
+  /** Reset limits are copied, so they may be a temporary. */
+  Controller(Hal& hal, Print& out, Sensor& sensor, Config& config, TempZones& zones, Force& force,
+    Recorder& recorder, ReportLog& reportLog, Slots& slots, Usage& usage, Capture& capture,
+    const ResetLimits& resetLimits = DEFAULT_RESET_LIMITS);
+
+  /** Call from the main loop after sensors and heater state were read. */
+  void check();
+
+  /** Executes command returned by Parser::parseCommand, does nothing for zero. */
+  void execute(char cmd);
+
+  void makeDump(char dumpType);
+
+private:
+  // Keep raw history of the profile, or none when the recorder keeps it (see readRecordedHistory)
+  static const unsigned int MAX_HISTORY = Profile::HISTORY_SIZE;
+  // Trends over 5, 15, and 60 minutes, and over 3 hours when raw history is that long
+  static const byte N_TRENDS = MAX_HISTORY >= 3 * Profile::SAMPLES_PER_HOUR ? 4 : 3;
+  static const byte HOUR_TREND = 2;
+
+  struct HistoryItem {
+    byte            work;
+    Sensor::temp_t  temp;
+  };
+
+  Hal&       _hal;
+  Print&     _out;
+  Sensor&    _sensor;
+  Config&    _config;
+  TempZones& _zones;
+  Force&     _force;
+  Recorder&  _recorder;
+  ReportLog& _reportLog;
+  Slots&     _slots;
+  Usage&     _usage;
+  Capture&   _capture;
+
+  // active/inactive time and temp
+  unsigned long   _inactiveStartMillis;
+  Sensor::temp_t  _inactiveStartTemp;
+  Sensor::temp_t  _inactiveDt;
+  int             _inactiveMinutes;
+  unsigned long   _activeStartMillis;
+  Sensor::temp_t  _activeStartTemp;
+  Sensor::temp_t  _activeDt;
+  int             _activeMinutes;
+  boolean         _wasInactive;
+  boolean         _wasActive;
+
+  // state history
+  Trend           _trend[N_TRENDS];
+  HistoryItem     _h[MAX_HISTORY != 0 ? MAX_HISTORY : 1]; // unused on the lean profile
+  unsigned int    _hHead;
+  unsigned int    _hTail;
+  unsigned int    _hSize;
+  int             _hSumWork; // over the last hour
+  int             _hWorkMinutes;
+  Sensor::temp_t  _hDeltaTemp;
+  Timeout         _hTimeout;
+
+  // dump state
+  boolean         _firstDump;
+  Timeout         _dumpTimeout;
+  unsigned long   _lastDumpTime; // last dumped values for adaptive reporting
+  Sensor::temp_t  _lastDumpTemp;
+  byte            _lastDumpState;
+  byte            _lastDumpZone;
+  unsigned long   _daystart;
+  int             _updays;
+
+  State::Mode     _prevMode;
+  boolean         _wasError;
+
+  // reset
+  const ResetLimits _resetLimits;
+  long            _lastResetConditionTime;
+  long            _lastOkConditionTime;
+  long            _resetConditionWaitInterval;
+
+  Controller(const Controller& other); // no copy constructor
+
+  void checkInactive();
+  void saveHistory();
+  unsigned int historyBack(unsigned int n);
+  void saveRawHistory(byte work, Sensor::temp_t temp);
+  void readRecordedHistory(Sensor::temp_t temp);
+  long nextDumpInterval();
+  boolean isReportChange();
+  void dumpState();
+  void saveMode();
+  void updateMode();
+  void checkError();
+  boolean hasResetCondition();
+  void checkReset();
+};
+
+#endif /* CONTROLLER_H_ */
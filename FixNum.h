@@ -6,6 +6,14 @@
 
 // Public API for FixNum library
 
+template<typename T, byte prec> class FixNum;
+
+// Result of arithmetic between FixNums has the larger type and the larger precision of the two
+template<typename T1, byte prec1, typename T2, byte prec2> class FixNumResult {
+public:
+  typedef FixNum<typename FixNumUtil::Common<T1, T2>::type, FixNumUtil::MaxPrec<prec1, prec2>::value> type;
+};
+
 template<typename T, byte prec> class FixNum {
 private:
   T _mantissa;
@@ -28,6 +36,11 @@ public:
   byte format(char* pos, byte size, Fmt fmt = NONE);   
   size_t printTo(Print& p);
   template<typename T2, byte prec2> operator FixNum<T2, prec2>();
+  // Arithmetic saturates to invalid on overflow, invalid operands give invalid result
+  template<typename T2, byte prec2> typename FixNumResult<T, prec, T2, prec2>::type operator +(FixNum<T2, prec2> other);
+  template<typename T2, byte prec2> typename FixNumResult<T, prec, T2, prec2>::type operator -(FixNum<T2, prec2> other);
+  FixNum<T, prec> operator *(int k);
+  FixNum<T, prec> operator /(int k); // rounds half away from zero
   // Comparisons
   template<typename T2, byte prec2> boolean operator ==(FixNum<T2, prec2> other);
   template<typename T2, byte prec2> boolean operator !=(FixNum<T2, prec2> other);
@@ -102,16 +115,51 @@ template<typename T, byte prec> size_t FixNum<T, prec>::printTo(Print& p) {
 }
 
 template<typename T, byte prec> template<typename T2, byte prec2> inline FixNum<T, prec>::operator FixNum<T2, prec2>() {
-  return FixNum<T2, prec2>(FixNumUtil::convert<T, T2>(_mantissa, prec, prec2));
+  if (!valid())
+    return FixNum<T2, prec2>::invalid();
+  typedef typename FixNumUtil::Common<T, T2>::type T0;
+  return FixNum<T2, prec2>(FixNumUtil::narrow<T0, T2>(FixNumUtil::Scale<T0, prec, prec2>::scale(_mantissa)));
+}
+
+template<typename T, byte prec> template<typename T2, byte prec2> 
+inline typename FixNumResult<T, prec, T2, prec2>::type FixNum<T, prec>::operator +(FixNum<T2, prec2> other) {
+  typedef typename FixNumResult<T, prec, T2, prec2>::type R;
+  R x1 = *this;
+  R x2 = other;
+  if (!x1.valid() || !x2.valid())
+    return R::invalid();
+  return R(FixNumUtil::add(x1.mantissa(), x2.mantissa()));
+}
+
+template<typename T, byte prec> template<typename T2, byte prec2> 
+inline typename FixNumResult<T, prec, T2, prec2>::type FixNum<T, prec>::operator -(FixNum<T2, prec2> other) {
+  typedef typename FixNumResult<T, prec, T2, prec2>::type R;
+  R x1 = *this;
+  R x2 = other;
+  if (!x1.valid() || !x2.valid())
+    return R::invalid();
+  return R(FixNumUtil::sub(x1.mantissa(), x2.mantissa()));
+}
+
+template<typename T, byte prec> inline FixNum<T, prec> FixNum<T, prec>::operator *(int k) {
+  if (!valid())
+    return invalid();
+  return FixNum<T, prec>(FixNumUtil::mul(_mantissa, k));
+}
+
+template<typename T, byte prec> inline FixNum<T, prec> FixNum<T, prec>::operator /(int k) {
+  if (!valid() || k == 0)
+    return invalid();
+  return FixNum<T, prec>(FixNumUtil::div(_mantissa, k));
 }
 
 template<typename T, byte prec> template<typename T2, byte prec2> boolean FixNum<T, prec>::operator ==(FixNum<T2, prec2> other) {
   if (!valid() || !other.valid())
     return false;
   typedef typename FixNumUtil::Common<T, T2>::type T0;
-  byte p0 = max(prec, prec2);
-  T0 x1 = FixNumUtil::scale((T0)_mantissa, prec, p0);
-  T0 x2 = FixNumUtil::scale((T0)other.mantissa(), prec2, p0);
+  const byte p0 = FixNumUtil::MaxPrec<prec, prec2>::value;
+  T0 x1 = FixNumUtil::Scale<T0, prec, p0>::scale(_mantissa);
+  T0 x2 = FixNumUtil::Scale<T0, prec2, p0>::scale(other.mantissa());
   return x1 == x2;  
 }
 
@@ -119,9 +167,9 @@ template<typename T, byte prec> template<typename T2, byte prec2> boolean FixNum
   if (!valid() || !other.valid())
     return false;
   typedef typename FixNumUtil::Common<T, T2>::type T0;
-  byte p0 = max(prec, prec2);
-  T0 x1 = FixNumUtil::scale((T0)_mantissa, prec, p0);
-  T0 x2 = FixNumUtil::scale((T0)other.mantissa(), prec2, p0);
+  const byte p0 = FixNumUtil::MaxPrec<prec, prec2>::value;
+  T0 x1 = FixNumUtil::Scale<T0, prec, p0>::scale(_mantissa);
+  T0 x2 = FixNumUtil::Scale<T0, prec2, p0>::scale(other.mantissa());
   return x1 != x2;  
 }
   
@@ -129,9 +177,9 @@ template<typename T, byte prec> template<typename T2, byte prec2> boolean FixNum
   if (!valid() || !other.valid())
     return false;
   typedef typename FixNumUtil::Common<T, T2>::type T0;
-  byte p0 = max(prec, prec2);
-  T0 x1 = FixNumUtil::scale((T0)_mantissa, prec, p0);
-  T0 x2 = FixNumUtil::scale((T0)other.mantissa(), prec2, p0);
+  const byte p0 = FixNumUtil::MaxPrec<prec, prec2>::value;
+  T0 x1 = FixNumUtil::Scale<T0, prec, p0>::scale(_mantissa);
+  T0 x2 = FixNumUtil::Scale<T0, prec2, p0>::scale(other.mantissa());
   return x1 < x2;  
 }
   
@@ -139,9 +187,9 @@ template<typename T, byte prec> template<typename T2, byte prec2> boolean FixNum
   if (!valid() || !other.valid())
     return false;
   typedef typename FixNumUtil::Common<T, T2>::type T0;
-  byte p0 = max(prec, prec2);
-  T0 x1 = FixNumUtil::scale((T0)_mantissa, prec, p0);
-  T0 x2 = FixNumUtil::scale((T0)other.mantissa(), prec2, p0);
+  const byte p0 = FixNumUtil::MaxPrec<prec, prec2>::value;
+  T0 x1 = FixNumUtil::Scale<T0, prec, p0>::scale(_mantissa);
+  T0 x2 = FixNumUtil::Scale<T0, prec2, p0>::scale(other.mantissa());
   return x1 <= x2;  
 }
   
@@ -149,9 +197,9 @@ template<typename T, byte prec> template<typename T2, byte prec2> boolean FixNum
   if (!valid() || !other.valid())
     return false;
   typedef typename FixNumUtil::Common<T, T2>::type T0;
-  byte p0 = max(prec, prec2);
-  T0 x1 = FixNumUtil::scale((T0)_mantissa, prec, p0);
-  T0 x2 = FixNumUtil::scale((T0)other.mantissa(), prec2, p0);
+  const byte p0 = FixNumUtil::MaxPrec<prec, prec2>::value;
+  T0 x1 = FixNumUtil::Scale<T0, prec, p0>::scale(_mantissa);
+  T0 x2 = FixNumUtil::Scale<T0, prec2, p0>::scale(other.mantissa());
   return x1 > x2;  
 }
   
@@ -159,9 +207,9 @@ template<typename T, byte prec> template<typename T2, byte prec2> boolean FixNum
   if (!valid() || !other.valid())
     return false;
   typedef typename FixNumUtil::Common<T, T2>::type T0;
-  byte p0 = max(prec, prec2);
-  T0 x1 = FixNumUtil::scale((T0)_mantissa, prec, p0);
-  T0 x2 = FixNumUtil::scale((T0)other.mantissa(), prec2, p0);
+  const byte p0 = FixNumUtil::MaxPrec<prec, prec2>::value;
+  T0 x1 = FixNumUtil::Scale<T0, prec, p0>::scale(_mantissa);
+  T0 x2 = FixNumUtil::Scale<T0, prec2, p0>::scale(other.mantissa());
   return x1 >= x2;  
 }
 
@@ -84,7 +84,7 @@ namespace FixNumUtil {
   
   template<typename T1, typename T2> inline T2 narrow(T1 x) {
     T2 x2 = (T2)x;
-    if (x2 != x) // does not fit
+    if (x2 != x || x2 < Limits<T2>::minValue) // does not fit, or below the symmetric range
       return x < 0 ? Limits<T2>::minValue : Limits<T2>::maxValue;
     return x2; // narrow Ok  
   }
@@ -117,6 +117,90 @@ namespace FixNumUtil {
     }  
   }
 
+  // ----------- Change decimal precision at compile time -----------
+
+  template<byte prec1, byte prec2> class MaxPrec {
+  public:
+    static const byte value = prec1 > prec2 ? prec1 : prec2;
+  };
+
+  template<byte n> class Pow10 {
+  public:
+    static const long value = 10 * Pow10<n - 1>::value;
+  };
+
+  template<> class Pow10<0> {
+  public:
+    static const long value = 1;
+  };
+
+  // Saturates when scaling up, rounds half away from zero when scaling down
+  template<typename T, byte prec1, byte prec2, bool up = (prec2 >= prec1)> class Scale {};
+
+  template<typename T, byte prec1, byte prec2> class Scale<T, prec1, prec2, true> {
+  public:
+    static T scale(T x) {
+      const long f = Pow10<prec2 - prec1>::value;
+      if (f == 1)
+        return x;
+      if (x > Limits<T>::maxValue / f)
+        return Limits<T>::maxValue;
+      if (x < Limits<T>::minValue / f)
+        return Limits<T>::minValue;
+      return x * (T)f;
+    }
+  };
+
+  template<typename T, byte prec1, byte prec2> class Scale<T, prec1, prec2, false> {
+  public:
+    static T scale(T x) {
+      const long f = Pow10<prec1 - prec2>::value;
+      if (x >= Limits<T>::maxValue || x <= Limits<T>::minValue)
+        return x;
+      if (f > Limits<T>::maxValue)
+        return 0;
+      T q = x / (T)f;
+      T r = x % (T)f;
+      if (r >= (T)(f - f / 2))
+        q++;
+      else if (r <= -(T)(f - f / 2))
+        q--;
+      return q;
+    }
+  };
+
+  // ----------- Saturating arithmetic -----------
+
+  template<typename T> inline T add(T a, T b) {
+    if (b > 0 ? a > Limits<T>::maxValue - b : a < Limits<T>::minValue - b)
+      return b > 0 ? Limits<T>::maxValue : Limits<T>::minValue;
+    return a + b;
+  }
+
+  template<typename T> inline T sub(T a, T b) {
+    if (b > 0 ? a < Limits<T>::minValue + b : a > Limits<T>::maxValue + b)
+      return b > 0 ? Limits<T>::minValue : Limits<T>::maxValue;
+    return a - b;
+  }
+
+  template<typename T> inline T mul(T a, int k) {
+    return narrow<long, T>((long)a * k);
+  }
+
+  template<> inline long mul<long>(long a, int k) {
+    if (k != 0 && labs(a) > Limits<long>::maxValue / abs(k))
+      return (a < 0) != (k < 0) ? Limits<long>::minValue : Limits<long>::maxValue;
+    return a * k;
+  }
+
+  template<typename T> inline T div(T a, int k) {
+    long q = (long)a / k;
+    long r = (long)a % k;
+    if (2 * labs(r) >= abs(k))
+      q += (a < 0) != (k < 0) ? -1 : 1;
+    return narrow<long, T>(q);
+  }
+
   // ----------- Change decimal precision and type -----------
   
   template<typename T1, typename T2> T2 convert(T1 x, byte prec1, byte prec2) {
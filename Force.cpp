@@ -4,28 +4,77 @@
 #include "TempZones.h"
 #include "state_hal.h"
 
-Force force;
+static inline boolean getZoneBit(byte* bits, byte i) {
+  return (bits[i >> 3] & (1 << (i & 7))) != 0;
+}
+
+static inline void setZoneBit(byte* bits, byte i, boolean value) {
+  if (value)
+    bits[i >> 3] |= 1 << (i & 7);
+  else
+    bits[i >> 3] &= ~(1 << (i & 7));
+}
+
+// Updates zone bit and keeps track of the lowest zone with bit set
+static void updateLowest(byte* bits, byte& lowest, byte i, boolean below) {
+  setZoneBit(bits, i, below);
+  if (below) {
+    if (i < lowest)
+      lowest = i;
+  } else if (i == lowest) {
+    // find next one (rare)
+    lowest = TempZones::N_ZONES;
+    for (byte j = i + 1; j < TempZones::N_ZONES; j++)
+      if (getZoneBit(bits, j)) {
+        lowest = j;
+        break;
+      }
+  }
+}
+
+Force::Force(Hal& hal, Config& config, TempZones& zones) :
+  _hal(hal),
+  _config(config),
+  _zones(zones),
+  _wasActive(false),
+  _lastActiveChangeTime(0),
+  _wasForced(false),
+  _wasForcedOff(false),
+  _wasForcedMode(State::MODE_UNKNOWN),
+  _wasForcedSavedForce(OFF),
+  _belowA(),
+  _belowB(),
+  _belowP(),
+  _lowestA(TempZones::N_ZONES),
+  _lowestB(TempZones::N_ZONES),
+  _countP(0)
+{}
+
+void Force::zoneChanged(byte i) {
+  TempZones::temp_t temp = _zones.get(i);
+  Config::Zone& zone = _config.zone[i];
+  updateLowest(_belowA, _lowestA, i, temp < zone.tempA.read());
+  updateLowest(_belowB, _lowestB, i, temp < zone.tempB.read());
+  boolean belowP = temp < zone.tempP.read();
+  if (belowP != getZoneBit(_belowP, i)) {
+    setZoneBit(_belowP, i, belowP);
+    if (belowP)
+      _countP++;
+    else
+      _countP--;
+  }
+}
 
 byte Force::getForcedZoneImpl() {
-  State::Mode mode = getMode();
-  boolean activeMode;
-  switch (mode) {
+  switch (_hal.mode()) {
   case State::MODE_WORKING:
   case State::MODE_TIMER:
-    activeMode = true;
-    break;
+    return _lowestA;
   case State::MODE_OFF:
-    activeMode = false;
-    break;
+    return _lowestB;
   default:
     return false; // unsupported mode  
   }
-  for (byte i = 0; i < TempZones::N_ZONES; i++) {
-    Config::temp_t configTemp = activeMode ? config.zone[i].tempA.read() : config.zone[i].tempB.read();
-    if (tempZones.temp[i].get() < configTemp) 
-      return i;
-  }
-  return TempZones::N_ZONES;
 }
 
 boolean Force::isTempBelowForceThreshold() {
@@ -38,10 +87,7 @@ byte Force::getForcedZone() {
 }
 
 boolean Force::isTempBelowPeriodicThreshold() {
-  for (byte i = 0; i < TempZones::N_ZONES; i++)
-    if (tempZones.temp[i].get() < config.zone[i].tempP.read()) 
-      return true;
-  return false;
+  return _countP > 0;
 }
 
 Force::AutoReason Force::checkAuto() {
@@ -50,14 +96,14 @@ Force::AutoReason Force::checkAuto() {
   if (isTempBelowForceThreshold())
     return AUTO_TEMP_LOW; // force on because temp is too low
   // check for periodic forcing
-  byte period = config.period.read();
-  byte duration = config.duration.read();
+  byte period = _config.period.read();
+  byte duration = _config.duration.read();
   if (period == 0 || duration == 0)
     return AUTO_NONE; // periodic forcing is not configured
   if (!isTempBelowPeriodicThreshold())
     return AUTO_NONE; // don't do periodic forcing as temp is not low enough
   // when inactive for period -- force on
-  if (millis() - _lastActiveChangeTime >= period * Timeout::MINUTE) 
+  if (_hal.millis() - _lastActiveChangeTime >= period * Timeout::MINUTE) 
       return AUTO_PERIODIC; // checkDuration method will turn it off when duration passes    
   return AUTO_NONE;    
 }
@@ -67,13 +113,13 @@ boolean Force::checkDuration() {
     if (_wasForcedOff)
       return false; // force was already canceled by some event (like mode change) during this active cycle 
     // keed forced on util it is active for specifed duration 
-    boolean keepForced = millis() - _lastActiveChangeTime < config.duration.read() * Timeout::MINUTE;
+    boolean keepForced = _hal.millis() - _lastActiveChangeTime < _config.duration.read() * Timeout::MINUTE;
     // also track changes in operation mode & saved mode and cancel force if any of them changes
     if (keepForced) {
       if (!_wasForced) {
-        _wasForcedMode = getMode();
-        _wasForcedSavedForce = config.force.read();
-      } else if (_wasForcedMode != getMode() || _wasForcedSavedForce != config.force.read()) {
+        _wasForcedMode = _hal.mode();
+        _wasForcedSavedForce = _config.force.read();
+      } else if (_wasForcedMode != _hal.mode() || _wasForcedSavedForce != _config.force.read()) {
         // something has changed -- cancel force
         keepForced = false;
         _wasForcedOff = true;
@@ -85,30 +131,31 @@ boolean Force::checkDuration() {
     // cleanup state when inactive
     _wasForced = false;
     _wasForcedOff = false;
+    return true;
   }
 }
 
 boolean Force::check() {
-  boolean isActive = getActiveBits() != 0;
+  boolean isActive = _hal.activeBits() != 0;
   if (isActive != _wasActive) {
-    _lastActiveChangeTime = millis();
+    _lastActiveChangeTime = _hal.millis();
     _wasActive = isActive;
   }
   AutoReason ar;
-  switch (config.force.read()) {
+  switch (_config.force.read()) {
   case Force::ON:
-    setForceOn(true);
+    _hal.setForceOn(true);
     return false;
   case Force::AUTO:
     ar = checkAuto();
     if (ar != AUTO_NONE)
-      setForceOn(true); // turn on when needed
+      _hal.setForceOn(true); // turn on when needed
     else if (checkDuration())
-      setForceOn(false); // will turn force off after timeout or mode change
+      _hal.setForceOn(false); // will turn force off after timeout or mode change
     return ar == AUTO_TEMP_LOW;
   default:
     // no force -- turn it off;
-    setForceOn(false);
+    _hal.setForceOn(false);
     return false;
   }
 }
@@ -8,6 +8,10 @@
 
 #include <Arduino.h>
 #include "state_hal.h"
+#include "Hal.h"
+#include "TempZones.h"
+
+class Config;
 
 class Force {
 public:  
@@ -17,10 +21,15 @@ public:
     AUTO  = 2,
   };
   
+  Force(Hal& hal, Config& config, TempZones& zones);
+
   /** Returns true when focing heater ON because temp is too low */
   boolean check();
 
   byte getForcedZone();
+
+  /** Updates thresholds state of zone, call when zone temp or its config changes. */
+  void zoneChanged(byte i);
   
 private:
   enum AutoReason {
@@ -29,6 +38,9 @@ private:
     AUTO_PERIODIC
   };
 
+  Hal&          _hal;
+  Config&       _config;
+  TempZones&    _zones;
   boolean       _wasActive;
   unsigned long _lastActiveChangeTime;
   boolean       _wasForced;
@@ -36,14 +48,23 @@ private:
   State::Mode   _wasForcedMode;
   Force::Mode   _wasForcedSavedForce;
 
+  // Zones below tempA, tempB, and tempP thresholds (bit per zone) 
+  static const byte ZONE_BYTES = (TempZones::N_ZONES + 7) / 8;
+  byte          _belowA[ZONE_BYTES];
+  byte          _belowB[ZONE_BYTES];
+  byte          _belowP[ZONE_BYTES];
+  byte          _lowestA; // lowest zone below tempA or N_ZONES
+  byte          _lowestB; // lowest zone below tempB or N_ZONES
+  byte          _countP;  // number of zones below tempP
+
   byte getForcedZoneImpl();
   boolean isTempBelowForceThreshold();
   boolean isTempBelowPeriodicThreshold();  
   AutoReason checkAuto();
   boolean checkDuration();
-};
 
-extern Force force;
+  Force(const Force& other); // no copy constructor
+};
 
 #endif
 
@@ -0,0 +1,20 @@
+#include "Hal.h"
+
+const long INITIAL_PRINT_INTERVAL = 1000L; // wait 1 s before first print to get XBee time to initialize & join
+const long PRINT_INTERVAL         = 250L;  // wait 250 ms between prints
+
+Hal::Hal() :
+  _printTimeout(0, INITIAL_PRINT_INTERVAL)
+{}
+
+boolean Hal::tryPrint() {
+  unsigned long now = millis();
+  if (!_printTimeout.check(now))
+    return false;
+  _printTimeout.reset(now, PRINT_INTERVAL);
+  return true;
+}
+
+void Hal::waitPrint() {
+  while (!tryPrint()); // just wait...
+}
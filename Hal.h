@@ -0,0 +1,43 @@
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <Arduino.h>
+#include "Timeout.h"
+#include "state_hal.h"
+
+/**
+ * Hardware of one controller: heater panel (state and mode inputs, mode buttons, and forced turn on),
+ * preset knobs, clock, and pacing of its serial output. Firmware modules take it by reference instead
+ * of calling the *_hal.cpp functions and millis(), so a host process can run many controllers, each
+ * with its own Hal. All of them are built at time zero of its clock.
+ */
+class Hal {
+public:
+  Hal();
+
+  virtual State::Mode mode() = 0;                       // one of MODE_xxx constants
+  virtual byte state() = 0;                             // a combination of STATE_xxx bits
+  virtual byte activeBits() = 0;
+  virtual byte errorBits() = 0;
+  virtual unsigned long modeTime(State::Mode mode) = 0; // time of the last change to mode
+  virtual void changeMode(State::Mode mode) = 0;
+  virtual void setForceOn(boolean on) = 0;
+  virtual boolean isForceOn() = 0;
+  virtual int presetTemp() = 0;
+  virtual int presetTime() = 0;
+  virtual unsigned long millis() = 0;
+  virtual long random(long howsmall, long howbig) = 0;
+
+  /** Returns true and reserves output for printing when enough time passed since previous print. */
+  boolean tryPrint();
+
+  /** Waits until output can be reserved for printing. */
+  void waitPrint();
+
+private:
+  Timeout _printTimeout;
+
+  Hal(const Hal& other); // no copy constructor
+};
+
+#endif /* HAL_H_ */
@@ -0,0 +1,31 @@
+#include <limits.h>
+#include <avr/sleep.h>
+#include "Idle.h"
+
+Idle idle;
+
+void Idle::sleep() {
+  if (Serial.available())
+    return;
+  unsigned long start = micros();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  sleep_cpu();
+  sleep_disable();
+  _idleMicros += micros() - start;
+  if (_idleMicros >= 1000) {
+    _idleMillis += _idleMicros / 1000;
+    _idleMicros %= 1000;
+  }
+}
+
+byte Idle::percent() {
+  unsigned long now = millis();
+  unsigned long window = now - _windowStart;
+  unsigned long result = 0;
+  if (window > 0) // scaled down only for windows of more than 11 hours, avoids 64-bit division
+    result = _idleMillis <= ULONG_MAX / 100 ? _idleMillis * 100 / window : _idleMillis / (window / 100);
+  _windowStart = now;
+  _idleMillis = 0;
+  return min(result, 100UL); // the first sleep may have started in the previous window
+}
@@ -0,0 +1,29 @@
+/**
+ * Idle sleep between loop iterations. All scheduled work is gated by timeouts of 100 ms or more
+ * and millis() timer interrupt wakes CPU every 1 ms, so it is enough to sleep once per loop until
+ * any interrupt (timer, serial RX, state pin, or 1-Wire) instead of computing the next deadline.
+ * Time spent asleep is accounted to measure CPU headroom.
+ */
+
+#ifndef IDLE_H_
+#define IDLE_H_
+
+#include <Arduino.h>
+
+class Idle {
+public:
+  /** Sleeps until the next interrupt unless there is serial input to process. */
+  void sleep();
+
+  /** Returns percent of time spent asleep since the previous call. */
+  byte percent();
+
+private:
+  unsigned long _windowStart; // millis() at the previous percent() call
+  unsigned long _idleMillis;
+  unsigned int  _idleMicros;  // below one millisecond, carried to _idleMillis
+};
+
+extern Idle idle;
+
+#endif
@@ -0,0 +1,45 @@
+#include "NtcSensor.h"
+
+const int ADC_MAX = 1023;
+const float T0 = 273.15 + 25; // nominal temperature of thermistor in K
+
+NtcSensor::NtcSensor(byte pin, byte zone, int beta) :
+  _pin(pin),
+  _zone(zone),
+  _beta(beta),
+  _value(temp_t::invalid())
+{}
+
+void NtcSensor::setup() {
+  _timeout.reset(INTERVAL);
+}
+
+void NtcSensor::read() {
+  if (!_timeout.check())
+    return;
+  _timeout.reset(INTERVAL);
+  int in = analogRead(_pin);
+  if (in <= 0 || in >= ADC_MAX) {
+    _value = temp_t::invalid(); // open or shorted
+    return;
+  }
+  // R / R0 = in / (ADC_MAX - in), 1 / T = 1 / T0 + ln(R / R0) / beta
+  float t = 1 / (1 / T0 + log((float)in / (ADC_MAX - in)) / _beta) - 273.15;
+  int sample = t < 0 ? (int)(t * 100 - 0.5) : (int)(t * 100 + 0.5);
+  if (!_value.valid())
+    _value = temp_t(sample);
+  else
+    _value = temp_t(_value.mantissa() + ((sample - _value.mantissa()) >> SMOOTH_SHIFT));
+}
+
+byte NtcSensor::count() {
+  return 1;
+}
+
+byte NtcSensor::zone(byte) {
+  return _zone;
+}
+
+NtcSensor::temp_t NtcSensor::value(byte) {
+  return _value;
+}
@@ -0,0 +1,35 @@
+#ifndef NTC_SENSOR_H_
+#define NTC_SENSOR_H_
+
+#include <Arduino.h>
+#include "Timeout.h"
+#include "Sensor.h"
+
+/**
+ * NTC thermistor on an analog pin, wired from the pin to ground with a series resistor of the
+ * same nominal resistance to VCC. The pin is sampled once per INTERVAL and the samples are
+ * smoothed by exponential moving average, open or shorted thermistor makes the value invalid.
+ */
+class NtcSensor : public Sensor {
+  public:
+    static const long INTERVAL = Timeout::SECOND;
+
+    NtcSensor(byte pin, byte zone, int beta = 3950);
+
+    virtual void setup();
+    virtual void read();
+    virtual byte count();
+    virtual byte zone(byte i);
+    virtual temp_t value(byte i);
+
+  private:
+    static const byte SMOOTH_SHIFT = 2; // average with weight 1/4 of the new sample
+
+    byte    _pin;
+    byte    _zone;
+    int     _beta;
+    temp_t  _value;
+    Timeout _timeout;
+};
+
+#endif /* NTC_SENSOR_H_ */
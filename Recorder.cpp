@@ -0,0 +1,156 @@
+#include "Recorder.h"
+#include "Config.h"
+
+Recorder::Recorder(Config& config) :
+  _config(config),
+  _items(),
+  _head(0),
+  _size(0),
+  _last(),
+  _upperNum(0),
+  _upperDen(0),
+  _lowerNum(0),
+  _lowerDen(0)
+{}
+
+void Recorder::add(byte work, temp_t temp) {
+  int corridor = _config.corridor.read();
+  if (corridor == 0 || corridor == 0xff) {
+    if (Profile::HISTORY_SIZE != 0)
+      return; // disabled (0xff is unprogrammed EEPROM)
+    corridor = DEFAULT_CORRIDOR;
+  }
+  if (_size == 0 || work != _last.work()) {
+    // keep the very first sample and work flips together with the sample before the flip
+    if (_size != 0 && _last.dt() != 0)
+      keep();
+    if (_size != 0)
+      narrowDoor(temp.mantissa() - _last.temp.mantissa(), 1, corridor);
+    setLast(work, _size == 0 ? 0 : 1, temp);
+    keep();
+    return;
+  }
+  byte dt = _last.dt() + 1;
+  if (dt <= MAX_DT && narrowDoor(temp.mantissa() - get(_size - 1).temp.mantissa(), dt, corridor)) {
+    setLast(work, dt, temp);
+    return;
+  }
+  // door closed or too long since last kept sample -- keep the last sample and open new door from it
+  keep();
+  narrowDoor(temp.mantissa() - _last.temp.mantissa(), 1, corridor);
+  setLast(work, 1, temp);
+}
+
+byte Recorder::size() {
+  return _size;
+}
+
+Recorder::Item& Recorder::get(byte i) {
+  byte j = _head + MAX_RECORDS - _size + i;
+  return _items[j % MAX_RECORDS];
+}
+
+Recorder::Item& Recorder::last() {
+  return _last;
+}
+
+unsigned int Recorder::samples() {
+  if (_size == 0)
+    return 0;
+  unsigned int n = 1 + _last.dt();
+  for (byte i = 1; i < _size; i++)
+    n += get(i).dt();
+  return n;
+}
+
+inline Recorder::Item& Recorder::item(byte j) {
+  return j < _size ? get(j) : _last;
+}
+
+// Keeps the last sample on the middle line of the door to bound the error, it becomes the base of the next door
+void Recorder::keep() {
+  byte dt = _last.dt();
+  if (dt != 0) {
+    long num = (long)_upperNum * _lowerDen + (long)_lowerNum * _upperDen;
+    long den = 2L * _upperDen * _lowerDen;
+    _last.temp = get(_size - 1).temp.mantissa() + (int)(num * dt / den);
+  }
+  _items[_head] = _last;
+  if (++_head == MAX_RECORDS)
+    _head = 0;
+  if (_size < MAX_RECORDS)
+    _size++;
+  _last.dtWork &= ~MAX_DT; // no samples after kept one yet
+}
+
+void Recorder::setLast(byte work, byte dt, temp_t temp) {
+  _last.dtWork = (work << 7) | dt;
+  _last.temp = temp;
+}
+
+// Narrows the door with the sample d away from the last kept one, returns false when the door is closed.
+// The door is left intact when it would close, so that keep() places the last sample within the old door.
+boolean Recorder::narrowDoor(int d, byte dt, int corridor) {
+  int upperNum = d - corridor; // compare slopes as fractions with positive denominators
+  byte upperDen = dt;
+  int lowerNum = d + corridor;
+  byte lowerDen = dt;
+  if (dt != 1 && (long)upperNum * _upperDen <= (long)_upperNum * dt) {
+    upperNum = _upperNum;
+    upperDen = _upperDen;
+  }
+  if (dt != 1 && (long)lowerNum * _lowerDen >= (long)_lowerNum * dt) {
+    lowerNum = _lowerNum;
+    lowerDen = _lowerDen;
+  }
+  if ((long)upperNum * lowerDen > (long)lowerNum * upperDen)
+    return false;
+  _upperNum = upperNum;
+  _upperDen = upperDen;
+  _lowerNum = lowerNum;
+  _lowerDen = lowerDen;
+  return true;
+}
+
+Recorder::Reader::Reader(Recorder& recorder) :
+  _recorder(recorder),
+  _j(0),
+  _k(0)
+{}
+
+void Recorder::Reader::skip(unsigned int n) {
+  while (n != 0) {
+    if (_j == 0) {
+      _j = 1;
+      _k = 1;
+      n--;
+      continue;
+    }
+    byte left = _recorder.item(_j).dt() - _k + 1; // samples left in the current segment
+    if (n < left) {
+      _k += n;
+      return;
+    }
+    n -= left;
+    _j++;
+    _k = 1;
+  }
+}
+
+void Recorder::Reader::next(byte& work, temp_t& temp) {
+  Item& b = _recorder.item(_j);
+  work = b.work();
+  if (_j == 0) {
+    temp = b.temp; // the oldest kept sample
+    _j = 1;
+    _k = 1;
+    return;
+  }
+  Item& a = _recorder.item(_j - 1);
+  byte dt = b.dt();
+  temp = a.temp.mantissa() + (int)((long)(b.temp.mantissa() - a.temp.mantissa()) * _k / dt);
+  if (++_k > dt) {
+    _j++;
+    _k = 1;
+  }
+}
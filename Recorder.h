@@ -0,0 +1,87 @@
+/**
+ * Compressing recorder of history samples. It keeps a sample only when temperature leaves
+ * the swinging door corridor of config.corridor (in 1/100 deg C) around the line from the
+ * last kept sample or when work bit flips. Each kept sample stores the number of history
+ * intervals since the previous one, so steady periods take a few bytes per hour.
+ * On the lean profile it is the only history of the controller (Profile::HISTORY_SIZE is zero),
+ * so it always runs there and Reader restores the samples by linear interpolation between kept ones.
+ */
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include <Arduino.h>
+#include "profile.h"
+#include "FixNum.h"
+
+class Config;
+
+class Recorder {
+public:
+  typedef FixNum<int, 2> temp_t;
+
+  static const byte MAX_RECORDS = Profile::N_RECORDS;
+  static const byte MAX_DT = 0x7f; // max intervals between kept samples
+  static const byte DEFAULT_CORRIDOR = 10; // when config.corridor is off, but the recorder keeps the history
+
+  class Item {
+  public:
+    byte   dtWork; // intervals since previous kept sample, work bit in the highest bit
+    temp_t temp;
+
+    byte dt();
+    byte work();
+  };
+
+  /** Reads samples oldest first, between kept samples they are interpolated within the corridor. */
+  class Reader {
+  public:
+    Reader(Recorder& recorder);
+
+    void skip(unsigned int n);
+    void next(byte& work, temp_t& temp);
+
+  private:
+    Recorder& _recorder;
+    byte      _j; // index of the kept sample at the end of the current segment, size() for the last one
+    byte      _k; // next sample in the current segment, 1 to its dt
+  };
+
+  Recorder(Config& config);
+
+  /** Adds new history sample, call it once per history interval. */
+  void add(byte work, temp_t temp);
+
+  byte size();
+  Item& get(byte i); // i-th kept sample, 0 is the oldest one
+  Item& last();      // last added sample (not kept yet)
+  unsigned int samples(); // number of samples from the oldest kept one to the last added one
+
+private:
+  Config& _config;
+  Item  _items[MAX_RECORDS];
+  byte  _head;
+  byte  _size;
+  Item  _last;     // last added sample, its dt is from the last kept one
+  int   _upperNum; // door upper slope (max of slopes to lower corridor bounds) as _upperNum / _upperDen
+  byte  _upperDen;
+  int   _lowerNum; // door lower slope (min of slopes to upper corridor bounds) as _lowerNum / _lowerDen
+  byte  _lowerDen;
+
+  Item& item(byte j); // kept samples, then the last added one
+  void keep();
+  void setLast(byte work, byte dt, temp_t temp);
+  boolean narrowDoor(int d, byte dt, int corridor);
+
+  Recorder(const Recorder& other); // no copy constructor
+};
+
+inline byte Recorder::Item::dt() {
+  return dtWork & MAX_DT;
+}
+
+inline byte Recorder::Item::work() {
+  return dtWork >> 7;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "ReportLog.h"
+#include "Controller.h"
+#include "state_hal.h"
+#include "Timeout.h"
+#include "xprint.h"
+
+// Report types by Report::type, the regular dump goes first
+const char TYPES[] PROGMEM = {
+  Controller::DUMP_REGULAR, Controller::DUMP_FIRST, Controller::DUMP_EXTERNAL_MODE_CHANGE,
+  Controller::DUMP_RESTORE_OFF_MODE, Controller::DUMP_HOTWATER_TIMEOUT, Controller::DUMP_CMD_RESPONSE,
+  Controller::DUMP_CMD_MODE_CHANGE, Controller::DUMP_POWER_LOST, Controller::DUMP_POWER_BACK,
+  Controller::DUMP_ERROR, Controller::DUMP_NORMAL, Controller::DUMP_FORCED_ON
+};
+
+const byte N_TYPES = sizeof(TYPES);
+
+static_assert(N_TYPES <= 16, "report types do not fit into Report::type");
+static_assert(MAX_MODE < 8 && STATE_SIZE <= 7 && TempZones::N_ZONES <= 64, "report fields do not fit into Report");
+
+ReportLog::ReportLog(Hal& hal, Print& out) :
+  _hal(hal),
+  _out(out),
+  _reports(),
+  _head(0),
+  _size(0),
+  _seq(0),
+  _time(0),
+  _temp(),
+  _request(0),
+  _pending(false)
+{}
+
+unsigned int ReportLog::add(char type, byte mode, byte state, temp_t temp, byte zone) {
+  unsigned long time = _hal.millis() / Timeout::SECOND;
+  Report& r = _reports[_head];
+  r.dt = _size == 0 ? 0 : min(time - _time, (unsigned long)MAX_DT);
+  r.type = 0;
+  for (byte i = 0; i < N_TYPES; i++)
+    if (pgm_read_byte(&TYPES[i]) == type)
+      r.type = i;
+  r.state = state;
+  r.mode = mode;
+  r.zone = zone;
+  if (!temp.valid()) {
+    r.dtemp = NO_TEMP; // and the restored temperature stays
+  } else if (!_temp.valid()) {
+    r.dtemp = 0; // the first valid one is the base
+    _temp = temp;
+  } else {
+    int d = temp.mantissa() - _temp.mantissa();
+    d = constrain((d + (d >= 0 ? TEMP_STEP / 2 : -TEMP_STEP / 2)) / TEMP_STEP, -127, 127); // large jumps catch up later
+    r.dtemp = d;
+    _temp = _temp.mantissa() + d * TEMP_STEP;
+  }
+  _time = time;
+  if (++_head == MAX_REPORTS)
+    _head = 0;
+  if (_size < MAX_REPORTS)
+    _size++;
+  return ++_seq;
+}
+
+void ReportLog::request(unsigned int seq) {
+  _request = seq;
+  _pending = true;
+}
+
+void ReportLog::check() {
+  if (!_pending)
+    return;
+  int after = _seq - _request; // number of reports after the requested one
+  if (after <= 0 || _size == 0) {
+    _pending = false; // all sent
+    return;
+  }
+  if (!_hal.tryPrint())
+    return; // wait until output is ready
+  // restore time and temperature of the oldest report after the requested one from the newest one
+  byte i = after < _size ? _size - after : 0;
+  unsigned long time = _time;
+  int temp = _temp.mantissa();
+  for (byte j = _size - 1; j > i; j--) {
+    Report& r = get(j);
+    time -= r.dt;
+    if (r.dtemp != NO_TEMP)
+      temp -= r.dtemp * TEMP_STEP;
+  }
+  Report& r = get(i);
+  unsigned int seq = _seq - (_size - 1 - i);
+  send(seq, time, r, r.dtemp != NO_TEMP ? temp_t(temp) : temp_t::invalid());
+  _request = seq;
+}
+
+inline ReportLog::Report& ReportLog::get(byte i) {
+  return _reports[(_head + MAX_REPORTS - _size + i) % MAX_REPORTS];
+}
+
+// Prints report as [CB#<seq> <type> m<mode> s<state> <temp> z<zone> u<uptime>]*
+void ReportLog::send(unsigned int seq, unsigned long time, Report& r, temp_t temp) {
+  char type = pgm_read_byte(&TYPES[r.type]);
+  printFmtOn_C(_out, "[CB#% % m% s% % z% u%]*\r\n", seq, type != 0 ? type : '-', (byte)r.mode,
+    FmtArg::bits(r.state, STATE_SIZE), temp, (byte)r.zone, (long)time);
+}
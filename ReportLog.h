@@ -0,0 +1,67 @@
+/**
+ * Store-and-forward log of the most recent state reports with sequence numbers.
+ * After reconnecting the gateway requests all reports after the last sequence number it has seen
+ * and they are sent one by one from the main loop whenever output is ready. Each report is kept in
+ * 5 bytes as changes since the previous one, so the lean profile keeps an hour of minute reports.
+ * The sequence number is appended to state dumps only when the gateway opts in with !CQ1.
+ */
+
+#ifndef REPORT_LOG_H_
+#define REPORT_LOG_H_
+
+#include <Arduino.h>
+#include "profile.h"
+#include "FixNum.h"
+#include "Hal.h"
+
+class ReportLog {
+public:
+  typedef FixNum<int, 2> temp_t;
+
+  static const byte MAX_REPORTS = Profile::N_REPORTS;
+
+  /** Resent reports are printed to out when hal has it ready. */
+  ReportLog(Hal& hal, Print& out);
+
+  /** Stores report and returns its sequence number. */
+  unsigned int add(char type, byte mode, byte state, temp_t temp, byte zone);
+
+  /** Requests to resend all stored reports with sequence numbers after seq. */
+  void request(unsigned int seq);
+
+  /** Sends next requested report when output is ready, call it from the main loop. */
+  void check();
+
+private:
+  static const unsigned int MAX_DT = 0xfff; // longer gaps between reports are shortened to it (s)
+  static const int TEMP_STEP = 5;           // 1/100 deg C
+  static const signed char NO_TEMP = -128;  // dtemp of invalid temperature
+
+  class Report {
+  public:
+    unsigned int dt    : 12; // seconds since the previous report, up to MAX_DT
+    unsigned int type  : 4;  // index in TYPES (ReportLog.cpp)
+    unsigned int state : 7;
+    unsigned int mode  : 3;
+    unsigned int zone  : 6;
+    signed char  dtemp;      // temperature change since the previous report in TEMP_STEP or NO_TEMP
+  };
+
+  Hal&          _hal;
+  Print&        _out;
+  Report        _reports[MAX_REPORTS];
+  byte          _head;
+  byte          _size;
+  unsigned int  _seq;     // sequence number of the newest report
+  unsigned long _time;    // uptime of the newest report in seconds
+  temp_t        _temp;    // temperature of the newest report as restored from the changes
+  unsigned int  _request; // send reports after this one
+  boolean       _pending; // true when there is request to serve
+
+  Report& get(byte i); // i-th report, 0 is the oldest one
+  void send(unsigned int seq, unsigned long time, Report& r, temp_t temp);
+
+  ReportLog(const ReportLog& other); // no copy constructor
+};
+
+#endif
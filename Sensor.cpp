@@ -0,0 +1,26 @@
+#include "Sensor.h"
+#include "TempZones.h"
+
+Sensor::temp_t Sensor::value() {
+  for (byte i = 0; i < count(); i++)
+    if (zone(i) == 0)
+      return value(i);
+  return temp_t::invalid();
+}
+
+void setupSensors(Sensor* const* sensors, byte count) {
+  for (byte k = 0; k < count; k++)
+    sensors[k]->setup();
+}
+
+void readSensors(Sensor* const* sensors, byte count, TempZones& zones) {
+  for (byte k = 0; k < count; k++) {
+    Sensor* sensor = sensors[k];
+    sensor->read();
+    for (byte i = 0; i < sensor->count(); i++) {
+      byte zone = sensor->zone(i);
+      if (zone < TempZones::N_ZONES)
+        zones.setValue(zone, sensor->value(i));
+    }
+  }
+}
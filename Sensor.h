@@ -0,0 +1,41 @@
+#ifndef SENSOR_H_
+#define SENSOR_H_
+
+#include <Arduino.h>
+#include "FixNum.h"
+
+class TempZones;
+class FmtLine;
+
+/**
+ * Local temperature sensor with one or more channels, each mapped to a TempZones index. Sensors
+ * are scheduled by the main loop via readSensors, so read() must never block: it starts or
+ * polls conversions and returns at once, and value(i) returns the last filtered result or
+ * invalid value when there is none.
+ */
+class Sensor {
+  public:
+    typedef FixNum<int, 2> temp_t;
+
+    static const byte NO_ZONE = 0xff;
+
+    virtual void setup() = 0;       // may block, called once from setup
+    virtual void read() = 0;        // starts or polls conversion without blocking
+    virtual byte count() = 0;       // number of channels
+    virtual byte zone(byte i) = 0;  // TempZones index of i-th channel or NO_ZONE
+    virtual temp_t value(byte i) = 0; // value of i-th channel in 1/100 of degree Centigrade
+    virtual void printInfo(FmtLine& line) {} // prints health counters into !CI dump, nothing by default
+
+    temp_t value(); // value of channel in zone 0 (boiler)
+};
+
+/** Sets up all sensors. */
+void setupSensors(Sensor* const* sensors, byte count);
+
+/**
+ * Reads all sensors and copies every channel to its zone in zones, call it from the main loop.
+ * Invalid values are copied too, so a failed sensor invalidates its zone at once.
+ */
+void readSensors(Sensor* const* sensors, byte count, TempZones& zones);
+
+#endif /* SENSOR_H_ */
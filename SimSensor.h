@@ -0,0 +1,34 @@
+#ifndef SIM_SENSOR_H_
+#define SIM_SENSOR_H_
+
+#include <Arduino.h>
+#include "Sensor.h"
+
+/**
+ * Simulated single channel sensor for host builds and bench tests, it reports whatever value
+ * was set last and is invalid until then.
+ */
+class SimSensor : public Sensor {
+  public:
+    SimSensor(byte zone);
+
+    void set(temp_t value);
+
+    virtual void setup() {}
+    virtual void read() {}
+    virtual byte count() { return 1; }
+    virtual byte zone(byte) { return _zone; }
+    virtual temp_t value(byte) { return _value; }
+
+  private:
+    byte   _zone;
+    temp_t _value;
+};
+
+inline SimSensor::SimSensor(byte zone) : _zone(zone), _value(temp_t::invalid()) {}
+
+inline void SimSensor::set(temp_t value) {
+  _value = value;
+}
+
+#endif /* SIM_SENSOR_H_ */
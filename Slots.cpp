@@ -0,0 +1,29 @@
+#include "Slots.h"
+#include "Config.h"
+
+Slots::Slots(Hal& hal, Config& config) :
+  _hal(hal),
+  _config(config),
+  _cycleStart(0)
+{}
+
+boolean Slots::enabled() {
+  return _config.slotNode.read() < _config.slotCount.read();
+}
+
+void Slots::beacon() {
+  _cycleStart = _hal.millis();
+}
+
+long Slots::nextSlot(long interval) {
+  unsigned long now = _hal.millis();
+  while (now - _cycleStart >= CYCLE)
+    _cycleStart += CYCLE; // keep it close to now
+  long slot = CYCLE / _config.slotCount.read();
+  long offset = _config.slotNode.read() * slot + slot / 8; // a bit after slot start to tolerate jitter
+  long start = interval - slot / 2; // the earliest time to report
+  long phase = (long)((now - _cycleStart) + start - offset) % CYCLE; // time since own slot
+  if (phase < 0)
+    phase += CYCLE;
+  return phase == 0 ? start : start + CYCLE - phase;
+}
@@ -0,0 +1,42 @@
+/**
+ * Time-slotted schedule of periodic reports for a fleet of controllers sharing one radio channel.
+ * Each CYCLE is divided into config.slotCount slots and this controller reports in the slot
+ * number config.slotNode. Cycle start is aligned with gateway beacons to correct the drift.
+ */
+
+#ifndef SLOTS_H_
+#define SLOTS_H_
+
+#include <Arduino.h>
+#include "Timeout.h"
+#include "Hal.h"
+
+class Config;
+
+class Slots {
+public:
+  static const long CYCLE = Timeout::MINUTE;
+
+  Slots(Hal& hal, Config& config);
+
+  /** Returns true when slotted schedule is configured. */
+  boolean enabled();
+
+  /** Marks start of the cycle by gateway beacon. */
+  void beacon();
+
+  /**
+   * Returns delay to the beginning of the first own slot that starts no earlier than half a slot
+   * before the specified interval from now, so the report is late rather than early.
+   */
+  long nextSlot(long interval);
+
+private:
+  Hal&          _hal;
+  Config&       _config;
+  unsigned long _cycleStart;
+
+  Slots(const Slots& other); // no copy constructor
+};
+
+#endif
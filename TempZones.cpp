@@ -1,7 +1,76 @@
 #include "TempZones.h"
+#include "Force.h"
 
-TempZones tempZones;
+TempZones::TempZones(Hal& hal, Force& force) :
+  stats(),
+  _hal(hal),
+  _force(force),
+  _index(),
+  _stamp(),
+  _tick(0),
+  _tickTimeout(0, TICK)
+{
+  // temp values are invalid
+}
+
+void TempZones::check() {
+  unsigned long now = _hal.millis();
+  if (!_tickTimeout.check(now))
+    return;
+  _tickTimeout.reset(now, TICK);
+  _tick++;
+  for (byte i = 0; i < N_ZONES; i++) {
+    if ((_value[i][0].valid() || _value[i][1].valid()) && (byte)(_tick - _stamp[i]) >= TIMEOUT_TICKS) {
+      _value[i][0] = temp_t::invalid();
+      _value[i][1] = temp_t::invalid();
+      if (stats[i].expired < 255)
+        stats[i].expired++;
+      _force.zoneChanged(i);
+    }
+  }
+}
+
+void TempZones::setValue(byte i, temp_t value) {
+  _stamp[i] = _tick;
+  if (_value[i][0].mantissa() == value.mantissa() && _value[i][1].mantissa() == value.mantissa())
+    return; // not changed
+  _value[i][0] = value;
+  _value[i][1] = value;
+  _force.zoneChanged(i);
+}
+
+void TempZones::setReceived(byte i, temp_t value) {
+  stats[i].received(_hal.millis());
+  _stamp[i] = _tick;
+  byte mask = 1 << (i & 7);
+  byte& index = _index[i >> 3];
+  _value[i][(index & mask) ? 1 : 0] = value;
+  index ^= mask;
+  _force.zoneChanged(i);
+}
+
+TempZones::temp_t TempZones::get(byte i) {
+  temp_t result = _value[i][0];
+  if (!(_value[i][1] < result)) // true when _value[i][1] is invalid
+    result = _value[i][1];
+  return result;  
+}
 
-TempZones::TempZones() {
-  // just a default constructor with invalid temp values
+void TempZones::Stats::received(unsigned long now) {
+  unsigned int time = now / Timeout::SECOND;
+  unsigned int gap = time - last;
+  last = time;
+  if (packets < UINT_MAX)
+    packets++;
+  if (packets == 1)
+    return; // first packet, no gap yet
+  if (packets == 2) {
+    minGap = gap;
+    avgGap = gap;
+    maxGap = gap;
+    return;
+  }
+  minGap = min(minGap, gap);
+  maxGap = max(maxGap, gap);
+  avgGap = ((long)avgGap * 7 + gap + 4) / 8;
 }
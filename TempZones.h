@@ -3,21 +3,66 @@
 
 #include <Arduino.h>
 #include "FixNum.h"
-#include "TimedValue.h"
+#include "Timeout.h"
+#include "Hal.h"
+#include "profile.h"
 
+class Force;
+
+/**
+ * Temperatures of all zones. Each value expires after TIMEOUT. Instead of a timeout per zone
+ * a shared coarse timer ticks every TICK and check() invalidates stale zones once per tick.
+ */
 class TempZones {
   public:
-    static const int  N_ZONES = 10;
+    static const int  N_ZONES = Profile::N_ZONES;
     static const long TIMEOUT = 5 * Timeout::MINUTE;
+    static const long TICK = 15 * Timeout::SECOND;
     
     typedef FixNum<int, 1> temp_t;
     
-    TimedValue<temp_t, TIMEOUT> temp[N_ZONES];
+    /** Link health of a remote zone, all times are in seconds. */
+    class Stats {
+      public:
+        unsigned int packets; // number of received packets
+        unsigned int last;    // time of last packet (wraps)
+        unsigned int minGap;  // min time between packets
+        unsigned int avgGap;  // exponential moving average of time between packets
+        unsigned int maxGap;  // max time between packets
+        byte         expired; // number of times value has expired (saturates at 255)
 
-    TempZones();
-};
+        void received(unsigned long now);
+    };
+    
+    Stats stats[N_ZONES];
 
-extern TempZones tempZones;
+    /** Zone changes are passed to force. */
+    TempZones(Hal& hal, Force& force);
 
-#endif /* TEMP_ZONES_H_ */
+    /** Expires stale zones, call it from the main loop. */
+    void check();
+
+    /** Sets actual value of zone, will be returned by get(). */
+    void setValue(byte i, temp_t value);
+
+    /** Sets value received from remote zone sensor, get() will return the max of last two received. */ 
+    void setReceived(byte i, temp_t value);
 
+    /** Returns max of the last two received values of zone. */
+    temp_t get(byte i);
+
+  private:
+    static const byte TIMEOUT_TICKS = TIMEOUT / TICK;
+
+    Hal&    _hal;
+    Force&  _force;
+    temp_t  _value[N_ZONES][2];
+    byte    _index[(N_ZONES + 7) / 8]; // bit per zone for the next _value to receive into
+    byte    _stamp[N_ZONES];           // tick of the last update
+    byte    _tick;
+    Timeout _tickTimeout;
+
+    TempZones(const TempZones& other); // no copy constructor
+};
+
+#endif /* TEMP_ZONES_H_ */
@@ -1,17 +1,17 @@
 #include "Timeout.h"
 
-boolean Timeout::check() {
+boolean Timeout::check(unsigned long now) {
   if (!enabled())
     return false;
-  if ((long)(millis() - _time) >= 0) {
+  if ((long)(now - _time) >= 0) {
     disable();
     return true;
   }
   return false;
 }
 
-void Timeout::reset(unsigned long interval) {
-  _time = millis() + interval;  
+void Timeout::reset(unsigned long now, unsigned long interval) {
+  _time = now + interval;  
   if (_time == 0) // just in case
     _time = 1;
 }
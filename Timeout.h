@@ -6,6 +6,7 @@
 /**
  * Simple timeout class that "fires" once by returning true from its "check" method when
  * previously spcified time interval passes. Auto-repeat is not supported. Call "reset".
+ * Modules that run on a Hal pass its time as now, the others use millis().
  */
 class Timeout {
   private:
@@ -18,10 +19,13 @@ class Timeout {
     
     Timeout();
     Timeout(unsigned long interval);
+    Timeout(unsigned long now, unsigned long interval);
     boolean check(); 
+    boolean check(unsigned long now);
     boolean enabled();
     void disable();
     void reset(unsigned long interval);
+    void reset(unsigned long now, unsigned long interval);
 };
 
 inline Timeout::Timeout() {}
@@ -30,6 +34,18 @@ inline Timeout::Timeout(unsigned long interval) {
   reset(interval);
 }
 
+inline Timeout::Timeout(unsigned long now, unsigned long interval) {
+  reset(now, interval);
+}
+
+inline boolean Timeout::check() {
+  return check(millis());
+}
+
+inline void Timeout::reset(unsigned long interval) {
+  reset(millis(), interval);
+}
+
 inline boolean Timeout::enabled() {
   return _time != 0;
 }
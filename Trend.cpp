@@ -0,0 +1,94 @@
+#include "Trend.h"
+
+Trend::Trend() :
+  _size(0),
+  _perHour(1),
+  _count(0),
+  _maxDelta(MAX_DELTA),
+  _base(0),
+  _s0(0),
+  _s1(0),
+  _s2(0)
+{}
+
+Trend::Trend(unsigned int size, byte perHour) :
+  _size(size),
+  _perHour(perHour),
+  _count(0),
+  _maxDelta(min(MAX_DELTA, (int)sqrt(0xffffffffUL / size))), // sum of d * d must fit
+  _base(0),
+  _s0(0),
+  _s1(0),
+  _s2(0)
+{}
+
+void Trend::add(temp_t y, temp_t removed) {
+  int d = y.mantissa() - _base;
+  if (_count == 0 || d > _maxDelta || d < -_maxDelta) {
+    // start over with new base
+    _count = 0;
+    _base = y.mantissa();
+    _s0 = 0;
+    _s1 = 0;
+    _s2 = 0;
+    d = 0;
+  }
+  if (_count < _size) {
+    _s1 += (long)_count * d;
+    _s0 += d;
+    _count++;
+  } else {
+    // shift positions of all samples by one and replace the oldest one
+    int dr = removed.mantissa() - _base;
+    _s1 -= _s0 - dr;
+    _s0 += d - dr;
+    _s1 += (long)(_size - 1) * d;
+    _s2 -= (long)dr * dr;
+  }
+  _s2 += (long)d * d;
+}
+
+void Trend::clear() {
+  _count = 0; // the next add starts over
+}
+
+unsigned int Trend::size() {
+  return _size;
+}
+
+unsigned int Trend::minutes() {
+  return (unsigned long)_size * 60 / _perHour;
+}
+
+unsigned int Trend::count() {
+  return _count;
+}
+
+Trend::temp_t Trend::mean() {
+  if (_count == 0)
+    return temp_t::invalid();
+  return result(_base + (float)_s0 / _count);
+}
+
+Trend::temp_t Trend::slope() {
+  if (_count < 2)
+    return temp_t::invalid();
+  float n = _count;
+  float sx = n * (n - 1) / 2;
+  float sxx = (n - 1) * n * (2 * n - 1) / 6;
+  return result((n * _s1 - sx * _s0) / (n * sxx - sx * sx) * _perHour);
+}
+
+Trend::temp_t Trend::deviation() {
+  if (_count == 0)
+    return temp_t::invalid();
+  float m = (float)_s0 / _count;
+  float var = (float)_s2 / _count - m * m;
+  return result(var > 0 ? sqrt(var) : 0);
+}
+
+Trend::temp_t Trend::result(float x) {
+  if (x >= FixNumUtil::Limits<int>::maxValue || x <= FixNumUtil::Limits<int>::minValue)
+    return temp_t::invalid();
+  return temp_t(x < 0 ? (int)(x - 0.5) : (int)(x + 0.5));
+}
@@ -0,0 +1,48 @@
+#ifndef TREND_H_
+#define TREND_H_
+
+#include <Arduino.h>
+#include "FixNum.h"
+
+/**
+ * Running least-squares slope, mean and variance over a sliding window of the last
+ * size samples. It is updated in O(1) per sample with incremental sums, so the caller
+ * shall provide the sample that falls out of the window when the window is full.
+ * Sums are kept relative to a base value to avoid overflows.
+ */
+class Trend {
+public:
+  typedef FixNum<int, 2> temp_t;
+
+  Trend(); // empty window, assign a sized one before use
+  Trend(unsigned int size, byte perHour);
+
+  /** Adds sample y, removed is the sample that was added size samples ago (ignored when not full). */
+  void add(temp_t y, temp_t removed);
+
+  /** Empties the window, so that it can be refilled from a history that does not keep every sample. */
+  void clear();
+
+  unsigned int size();
+  unsigned int minutes(); // window size in minutes
+  unsigned int count();
+  temp_t mean();
+  temp_t slope(); // per hour
+  temp_t deviation(); // square root of variance
+
+private:
+  static const int MAX_DELTA = 4000; // max deviation from base, lower for long windows to keep sums in range
+
+  unsigned int  _size;
+  byte          _perHour;
+  unsigned int  _count;
+  int           _maxDelta;
+  int           _base;
+  long          _s0; // sum of d
+  long          _s1; // sum of i * d, where i is position in window from 0 (oldest)
+  unsigned long _s2; // sum of d * d
+
+  temp_t result(float x);
+};
+
+#endif /* TREND_H_ */
@@ -0,0 +1,116 @@
+#include "Usage.h"
+#include "Timeout.h"
+
+inline byte msToMinutes(unsigned long ms) {
+  return (ms + Timeout::MINUTE / 2) / Timeout::MINUTE;
+}
+
+Usage::Usage(Hal& hal) :
+  _hal(hal),
+  _flags(0),
+  _lastTime(0),
+  _hourTime(0),
+  _acc(),
+  _hour(),
+  _hourHead(0),
+  _hours(0),
+  _hourOfDay(0),
+  _day(),
+  _dayHead(0),
+  _days(0),
+  _today()
+{}
+
+void Usage::check() {
+  unsigned long now = _hal.millis();
+  rollHours(now);
+  // find what is on now
+  byte flags = 0;
+  if (_hal.activeBits() != 0)
+    flags |= 1 << BURNER;
+  if (_hal.isForceOn())
+    flags |= 1 << FORCED;
+  if (_hal.errorBits() != 0)
+    flags |= 1 << ERROR;
+  flags |= 1 << (MODE + _hal.mode());
+  if (flags == _flags)
+    return; // nothing changed, will account later
+  account(now);
+  _flags = flags;
+}
+
+void Usage::snapshot() {
+  unsigned long now = _hal.millis();
+  rollHours(now);
+  account(now);
+}
+
+byte Usage::hours() {
+  return _hours;
+}
+
+byte Usage::days() {
+  return _days;
+}
+
+byte Usage::hour(byte i, byte c) {
+  byte j = _hourHead + N_HOURS - _hours + i;
+  return _hour[j % N_HOURS][c];
+}
+
+unsigned int Usage::day(byte i, byte c) {
+  byte j = _dayHead + N_DAYS - _days + i;
+  return _day[j % N_DAYS][c];
+}
+
+byte Usage::currentHour(byte c) {
+  return msToMinutes(_acc[c]);
+}
+
+unsigned int Usage::currentDay(byte c) {
+  return _today[c];
+}
+
+void Usage::rollHours(unsigned long now) {
+  while (now - _hourTime >= Timeout::HOUR) {
+    _hourTime += Timeout::HOUR;
+    account(_hourTime);
+    closeHour();
+  }
+}
+
+void Usage::account(unsigned long time) {
+  unsigned long elapsed = time - _lastTime;
+  _lastTime = time;
+  for (byte c = 0; c < N_CATEGORIES; c++)
+    if (_flags & (1 << c))
+      _acc[c] += elapsed;
+}
+
+void Usage::closeHour() {
+  for (byte c = 0; c < N_CATEGORIES; c++) {
+    byte minutes = msToMinutes(_acc[c]);
+    _hour[_hourHead][c] = minutes;
+    _today[c] += minutes;
+    _acc[c] = 0;
+  }
+  if (++_hourHead == N_HOURS)
+    _hourHead = 0;
+  if (_hours < N_HOURS)
+    _hours++;
+  if (++_hourOfDay == 24) {
+    _hourOfDay = 0;
+    closeDay();
+  }
+}
+
+void Usage::closeDay() {
+  for (byte c = 0; c < N_CATEGORIES; c++) {
+    _day[_dayHead][c] = _today[c];
+    _today[c] = 0;
+  }
+  if (++_dayHead == N_DAYS)
+    _dayHead = 0;
+  if (_days < N_DAYS)
+    _days++;
+}
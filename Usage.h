@@ -0,0 +1,66 @@
+/**
+ * Accounting of burner, forced, error, and per-mode time with per-hour buckets
+ * for the last day and per-day buckets for the last week (counted from startup).
+ * The lean profile keeps fewer buckets (see Profile::USAGE_HOURS and USAGE_DAYS).
+ */
+
+#ifndef USAGE_H_
+#define USAGE_H_
+
+#include <Arduino.h>
+#include "state_hal.h"
+#include "Hal.h"
+#include "profile.h"
+
+class Usage {
+public:
+  enum Category {
+    BURNER = 0, // Hal::activeBits() != 0
+    FORCED = 1, // Hal::isForceOn()
+    ERROR  = 2, // Hal::errorBits() != 0
+    MODE   = 3  // MODE + Hal::mode() for each mode
+  };
+
+  static const byte N_CATEGORIES = MODE + MAX_MODE + 1;
+  static const byte N_HOURS = Profile::USAGE_HOURS;
+  static const byte N_DAYS = Profile::USAGE_DAYS;
+
+  Usage(Hal& hal);
+
+  /** Accounts time since the last call, call it from the main loop. */
+  void check();
+
+  /** Accounts time up to now, so that the buckets are complete and stay still while they are read. */
+  void snapshot();
+
+  byte hours(); // number of complete hours (up to N_HOURS)
+  byte days();  // number of complete days (up to N_DAYS)
+  byte hour(byte i, byte c); // minutes in i-th complete hour, 0 is the oldest one
+  unsigned int day(byte i, byte c); // minutes in i-th complete day, 0 is the oldest one
+  byte currentHour(byte c); // minutes in current hour up to the last check or snapshot
+  unsigned int currentDay(byte c); // minutes in current day (complete hours only)
+
+private:
+  Hal&          _hal;
+  byte          _flags;    // bit per category that is currently on
+  unsigned long _lastTime; // time of last accounting
+  unsigned long _hourTime; // time of current hour start
+  unsigned long _acc[N_CATEGORIES]; // ms in current hour
+  byte          _hour[N_HOURS][N_CATEGORIES]; // ring of complete hours
+  byte          _hourHead; // next position in _hour to write
+  byte          _hours;
+  byte          _hourOfDay;
+  unsigned int  _day[N_DAYS][N_CATEGORIES]; // ring of complete days
+  byte          _dayHead; // next position in _day to write
+  byte          _days;
+  unsigned int  _today[N_CATEGORIES];
+
+  void rollHours(unsigned long now);
+  void account(unsigned long time);
+  void closeHour();
+  void closeDay();
+
+  Usage(const Usage& other); // no copy constructor
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include <avr/wdt.h>
+#include "Watchdog.h"
+#include "Timeout.h"
+
+const unsigned int CRUMB_MAGIC = 0xC7A5;
+const byte ALL_STAGES = (1 << Watchdog::N_STAGES) - 1;
+
+Watchdog watchdog;
+
+Watchdog::Breadcrumb crumb __attribute__ ((section (".noinit")));
+byte resetFlags __attribute__ ((section (".noinit")));
+
+// Runs from .init0 at the very start, Optiboot clears MCUSR and passes its value in r2. Nothing but
+// inline assembly is allowed here, the compiler assumes zero r1 and it is cleared in .init2.
+void saveBootFlags() __attribute__ ((naked, used, section (".init0")));
+
+void saveBootFlags() {
+  __asm__ __volatile__ ("sts %0, r2\n" : "=m" (resetFlags) :);
+}
+
+// Runs from .init3 before anything else, watchdog stays enabled after watchdog reset and must be
+// turned off before it fires again during startup. MCUSR is zero when the bootloader has cleared it,
+// then the flags are the ones it passed in r2.
+void saveResetFlags() __attribute__ ((naked, used, section (".init3")));
+
+void saveResetFlags() {
+  if (MCUSR != 0)
+    resetFlags = MCUSR;
+  MCUSR = 0;
+  wdt_disable();
+}
+
+boolean Watchdog::setup() {
+  boolean restarted = (resetFlags & _BV(WDRF)) && crumb.magic == CRUMB_MAGIC;
+  _lastCrumb = crumb;
+  crumb.magic = CRUMB_MAGIC;
+  crumb.stage = N_STAGES;
+  crumb.loops = 0;
+  crumb.uptime = millis() / Timeout::SECOND;
+  _stage = N_STAGES;
+  _stalledStage = N_STAGES;
+  wdt_enable(WDTO_8S);
+  return restarted;
+}
+
+void Watchdog::checkDeadline(unsigned long now) {
+  if (_stage != N_STAGES && now - _stageStart > (unsigned long)STAGE_DEADLINE) {
+    _stalls++;
+    _stalledStage = _stage;
+  }
+}
+
+void Watchdog::stage(Stage s) {
+  unsigned long now = millis();
+  checkDeadline(now);
+  _progress |= 1 << s;
+  _stage = s;
+  _stageStart = now;
+  crumb.stage = s;
+}
+
+void Watchdog::loopDone() {
+  unsigned long now = millis();
+  checkDeadline(now);
+  _stage = N_STAGES;
+  if (_progress == ALL_STAGES)
+    wdt_reset();
+  _progress = 0;
+  crumb.loops++;
+  crumb.uptime = now / Timeout::SECOND;
+}
@@ -0,0 +1,74 @@
+/**
+ * Hardware watchdog fed from the main loop when all loop stages made progress. Each stage is marked
+ * on entry and stages that take longer than STAGE_DEADLINE are counted as stalls. The current
+ * stage, loop counter, and uptime are kept as a breadcrumb in .noinit RAM that survives watchdog
+ * reset, so the stage that hung the loop is reported after restart. Watchdog reset is told from
+ * MCUSR, or from its copy in r2 when Optiboot has cleared it.
+ */
+
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <Arduino.h>
+
+class Watchdog {
+public:
+  enum Stage {
+    SENSORS  = 0, // DS18B20 and TempZones
+    STATE    = 1, // checkState
+    CONTROL  = 2, // Controller::check
+    COMMAND  = 3, // Parser::parseCommand and Controller::execute
+    FORCE    = 4, // Force::check
+    REPORT   = 5, // Usage, ReportLog, and LED
+    N_STAGES = 6
+  };
+
+  static const long STAGE_DEADLINE = 2000L; // changeMode may spin up to 1.8 s
+
+  class Breadcrumb {
+  public:
+    unsigned int  magic;
+    byte          stage;  // last entered stage
+    unsigned long loops;  // number of completed loops
+    unsigned long uptime; // seconds at the last completed loop
+  };
+
+  /** Enables watchdog, call it at the end of setup. Returns true when restarted by watchdog. */
+  boolean setup();
+
+  /** Marks start of the stage. */
+  void stage(Stage s);
+
+  /** Feeds watchdog if all stages made progress, call it at the end of loop. */
+  void loopDone();
+
+  Breadcrumb& lastCrumb(); // breadcrumb of the previous run, valid only when setup returned true
+  unsigned int stalls();   // number of stages that overrun STAGE_DEADLINE
+  byte stalledStage();     // the last stage that overrun STAGE_DEADLINE
+
+private:
+  Breadcrumb    _lastCrumb;
+  byte          _progress; // bit per stage entered in this loop
+  byte          _stage;
+  unsigned long _stageStart;
+  unsigned int  _stalls;
+  byte          _stalledStage;
+
+  void checkDeadline(unsigned long now);
+};
+
+inline Watchdog::Breadcrumb& Watchdog::lastCrumb() {
+  return _lastCrumb;
+}
+
+inline unsigned int Watchdog::stalls() {
+  return _stalls;
+}
+
+inline byte Watchdog::stalledStage() {
+  return _stalledStage;
+}
+
+extern Watchdog watchdog;
+
+#endif
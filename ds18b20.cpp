@@ -1,78 +1,206 @@
 #include "ds18b20.h"
+#include "Config.h"
+#include "Capture.h"
+#include "xprint.h"
 
 // Conversion period, 750 ms per spec
 const int DS18B20_INTERVAL = 750;
 
+static_assert(DS18B20::MAX_SENSORS <= 16, "sensor index must fit into low nibble of Capture event kind");
+
 // Scratch Pad Size with CRC
 const int DS18B20_SPS = 9;
 
+// 1-Wire commands
+const byte MATCH_ROM        = 0x55;
+const byte SKIP_ROM         = 0xCC;
+const byte CONVERT_T        = 0x44;
+const byte READ_SCRATCH_PAD = 0xBE;
+
 DS18B20::DS18B20(byte pin) :
-  _wire(pin)
+  _wire(pin),
+  _bus(pin),
+  _count(0),
+  _next(0),
+  _started(0),
+  _conversions(0),
+  _presenceErrors(0),
+  _crcErrors(0)
 {
-  for (byte i = 0; i < DS18B20_SIZE; i++)
-    _queue[i] = NO_VAL;
+  _tx.context = this;
 }
 
 void DS18B20::setup() {
+  search();
+  _bus.setup();
   startConversion();
   delay(DS18B20_INTERVAL);
 }
 
 void DS18B20::read() {
+  _bus.poll(); // invokes readDone when scratchpad read is complete
   if (_timeout.check()) {
-    enqueue(readScratchPad());
-    startConversion();
+    _next = 0; // conversion is over -- start reading sensors
+    readNext();
   }
 }
 
-DS18B20::temp_t DS18B20::value() {
+byte DS18B20::count() {
+  return _count;
+}
+
+byte DS18B20::zone(byte i) {
+  return config.sensor[_slot[i]].zone.read();
+}
+
+unsigned int DS18B20::started() {
+  return _started;
+}
+
+unsigned int DS18B20::conversions() {
+  return _conversions;
+}
+
+unsigned int DS18B20::presenceErrors() {
+  return _presenceErrors;
+}
+
+unsigned int DS18B20::crcErrors() {
+  return _crcErrors;
+}
+
+void DS18B20::printInfo(FmtLine& line) {
+  printFmtOn_C(line, " S% C% P% E%", _started, _conversions, _presenceErrors, _crcErrors);
+}
+
+DS18B20::temp_t DS18B20::value(byte i) {
+  return _filter[i].value();
+}
+
+void DS18B20::search() {
+  byte rom[ROM_SIZE];
+  _count = 0;
+  _wire.reset_search();
+  while (_count < MAX_SENSORS && _wire.search(rom)) {
+    if (rom[0] != FAMILY || OneWire::crc8(&rom[0], ROM_SIZE - 1) != rom[ROM_SIZE - 1])
+      continue; // not a DS18B20 or invalid CRC
+    byte slot = findSlot(rom);
+    if (slot < MAX_SENSORS)
+      _slot[_count++] = slot;
+  }
+}
+
+// Finds sensor in the persisted table or stores it into the first free slot
+byte DS18B20::findSlot(byte* rom) {
+  byte freeSlot = MAX_SENSORS;
+  for (byte slot = 0; slot < MAX_SENSORS; slot++) {
+    Config::Sensor& sensor = config.sensor[slot];
+    if (sensor.rom[0].read() != FAMILY) {
+      if (freeSlot == MAX_SENSORS)
+        freeSlot = slot;
+      continue;
+    }
+    byte k = 1;
+    while (k < ROM_SIZE && sensor.rom[k].read() == rom[k])
+      k++;
+    if (k == ROM_SIZE)
+      return slot; // found
+  }
+  if (freeSlot == MAX_SENSORS)
+    return freeSlot; // table is full
+  Config::Sensor& sensor = config.sensor[freeSlot];
+  // first sensor goes to zone 0 (boiler), others must be mapped via !CS command
+  sensor.zone = freeSlot == 0 ? 0 : NO_ZONE;
+  for (byte k = ROM_SIZE; k-- > 0;) // family code is written last
+    sensor.rom[k] = rom[k];
+  return freeSlot;
+}
+
+void DS18B20::readNext() {
+  if (_next >= _count) {
+    startConversion(); // all sensors were read
+    return;
+  }
+  Config::Sensor& sensor = config.sensor[_slot[_next]];
+  _tx.data[0] = MATCH_ROM;
+  for (byte k = 0; k < ROM_SIZE; k++)
+    _tx.data[k + 1] = sensor.rom[k].read();
+  _tx.data[ROM_SIZE + 1] = READ_SCRATCH_PAD;
+  _tx.writeSize = ROM_SIZE + 2;
+  _tx.readSize = DS18B20_SPS; // we need it with CRC
+  _tx.callback = readDone;
+  _bus.submit(&_tx);
+}
+
+void DS18B20::readDone(OneWireBus::Transaction& t) {
+  DS18B20* ds = (DS18B20*)t.context;
+  byte* data = &t.data[t.writeSize];
+  int val = NO_VAL;
+  if (!t.presence)
+    ds->_presenceErrors++;
+  else if (OneWireBus::crc8(data, DS18B20_SPS - 1) != data[DS18B20_SPS - 1])
+    ds->_crcErrors++;
+  else {
+    val = (data[1] << 8) + data[0]; // take the two bytes from the response relating to temperature
+    ds->_conversions++;
+  }
+  if (val != ds->_filter[ds->_next].last())
+    capture.add(Capture::TEMP | ds->_next, val != NO_VAL ? val : Capture::NO_TEMP);
+  ds->_filter[ds->_next].enqueue(val);
+  ds->_next++;
+  ds->readNext();
+}
+
+void DS18B20::startConversion() {
+  _timeout.reset(DS18B20_INTERVAL);
+  _tx.data[0] = SKIP_ROM;
+  _tx.data[1] = CONVERT_T; // start conversion on all sensors at once
+  _tx.writeSize = 2;
+  _tx.readSize = 0;
+  _tx.callback = conversionDone;
+  _bus.submit(&_tx);
+}
+
+void DS18B20::conversionDone(OneWireBus::Transaction& t) {
+  DS18B20* ds = (DS18B20*)t.context;
+  if (t.presence)
+    ds->_started++;
+  else
+    ds->_presenceErrors++;
+}
+
+// ----------- class DS18B20::Filter implementation -----------
+
+DS18B20::Filter::Filter() {
+  for (byte i = 0; i < DS18B20_SIZE; i++)
+    _queue[i] = NO_VAL;
+}
+
+int DS18B20::Filter::last() {
+  return _size > 0 ? _queue[(_tail + DS18B20_SIZE - 1) % DS18B20_SIZE] : NO_VAL;
+}
+
+DS18B20::temp_t DS18B20::Filter::value() {
   if (!_value.valid() && _size > 0)
     computeValue();
   return _value;
 }
 
-void DS18B20::enqueue(int val) {
+void DS18B20::Filter::enqueue(int val) {
   if (val == NO_VAL)
     return;
-  // dequeue previous value
-  if (_size == DS18B20_SIZE) {
-    if (_head == DS18B20_SIZE)
-      _head = 0;
-    _size--;
-  }
-
-  // enqueue new value
+  // enqueue new value over the oldest one
   _queue[_tail++] = val;
   if (_tail == DS18B20_SIZE)
     _tail = 0;
-  _size++;
+  if (_size < DS18B20_SIZE)
+    _size++;
 
   // reset computed value
   _value = temp_t::invalid();
 }
 
-int DS18B20::readScratchPad() {
-  if (!_wire.reset())
-    return NO_VAL;
-  _wire.skip();
-  _wire.write(0xBE); // Read Scratchpad
-  byte data[DS18B20_SPS];
-  for (byte i = 0; i < DS18B20_SPS; i++) // we need it with CRC
-    data[i] = _wire.read();
-  if (OneWire::crc8(&data[0], DS18B20_SPS - 1) != data[DS18B20_SPS - 1])
-    return temp_t::invalid(); // invalid CRC
-  return (data[1] << 8) + data[0]; // take the two bytes from the response relating to temperature
-}
-
-void DS18B20::startConversion() {
-  _timeout.reset(DS18B20_INTERVAL);
-  if (!_wire.reset())
-    return;
-  _wire.skip();
-  _wire.write(0x44, 0); // start conversion
-}
-
-void DS18B20::computeValue() {
+void DS18B20::Filter::computeValue() {
   int hi = INT_MIN;
   int lo = INT_MAX;
   int sum = 0;
@@ -81,7 +209,7 @@ void DS18B20::computeValue() {
     if (_queue[i] != NO_VAL) {
       sum += _queue[i];
       hi = max(hi, _queue[i]);
-      lo = min(hi, _queue[i]);
+      lo = min(lo, _queue[i]);
       count++;
     }
   if (count > 2) {
@@ -91,4 +219,3 @@ void DS18B20::computeValue() {
   }
   _value = temp_t(((long)sum * 100) / (count << 4));
 }
-
@@ -1,34 +1,81 @@
+#ifndef DS18B20_H_
+#define DS18B20_H_
+
 #include <Arduino.h>
 #include <OneWire.h>
 #include "Timeout.h"
 #include "FixNum.h"
+#include "onewire_bus.h"
+#include "Sensor.h"
+#include "profile.h"
 
-class DS18B20 {
+/**
+ * Bus of DS18B20 sensors on a single 1-Wire pin. Sensors are discovered with ROM search on setup
+ * and mapped to TempZones indexes via persisted config.sensor[] table. All sensors are converted
+ * at once with a broadcast Convert T and then their scratchpads are read one after another.
+ * Conversion and reads run asynchronously via OneWireBus, only ROM search on setup is blocking.
+ */
+class DS18B20 : public Sensor {
   public:
-    typedef FixNum<int, 2> temp_t;
+    static const byte MAX_SENSORS = Profile::N_SENSORS;
+    static const byte ROM_SIZE = 8;
+    static const byte FAMILY = 0x28; // family code of DS18B20 in ROM code
     
     DS18B20(byte pin);
   
-    void setup();
-    void read();
-    temp_t value(); // Returns value in 1/100 of degree Centigrade
+    virtual void setup();
+    virtual void read();
+    virtual byte count();         // Returns number of sensors found on the bus
+    virtual byte zone(byte i);    // Returns TempZones index for i-th sensor or NO_ZONE
+    virtual temp_t value(byte i); // Returns value of i-th sensor in 1/100 of degree Centigrade
+    using Sensor::value;          // Returns value of sensor in zone 0 (boiler)
+    virtual void printInfo(FmtLine& line); // Prints health counters as S<started> C<conversions> P<presence errors> E<CRC errors>
+
+    // Health counters
+    unsigned int started();        // Returns number of conversions started with presence pulse
+    unsigned int conversions();    // Returns number of sensor conversions read with valid CRC
+    unsigned int presenceErrors(); // Returns number of resets without presence pulse
+    unsigned int crcErrors();      // Returns number of scratchpad reads with invalid CRC
   
   private:
-    static const byte DS18B20_SIZE = 10;
+    static const byte DS18B20_SIZE = Profile::SENSOR_FILTER;
     static const int NO_VAL = INT_MAX;
+
+    class Filter {
+      private:
+        byte _tail;
+        byte _size;
+        int _queue[DS18B20_SIZE]; // queue of raw reads in 1/16 of degree Centigrade
+        temp_t _value; // computed value
+        
+        void computeValue();
+      public:
+        Filter();
+        void enqueue(int val);
+        int last(); // the newest raw read or NO_VAL
+        temp_t value();
+    };
     
-    OneWire _wire;
+    OneWire _wire; // used for ROM search only
+    OneWireBus _bus;
+    OneWireBus::Transaction _tx;
     Timeout _timeout;
-    byte _head;
-    byte _tail;
-    byte _size;
-    int _queue[DS18B20_SIZE]; // queue of raw reads in 1/16 of degree Centigrade
-    
-    temp_t _value; // computed value
+    byte _count; // number of found sensors
+    byte _next;  // next sensor to read scratchpad from 
+    unsigned int _started;
+    unsigned int _conversions;
+    unsigned int _presenceErrors;
+    unsigned int _crcErrors;
+    byte _slot[MAX_SENSORS]; // index in config.sensor[] for each found sensor
+    Filter _filter[MAX_SENSORS];
   
-    void enqueue(int val);
-    int readScratchPad();
+    void search();
+    byte findSlot(byte* rom);
+    void readNext();
     void startConversion();
-    void computeValue();
+    
+    static void readDone(OneWireBus::Transaction& t);
+    static void conversionDone(OneWireBus::Transaction& t);
 };
 
+#endif /* DS18B20_H_ */
@@ -1,61 +1,162 @@
 #include <Arduino.h>
 #include "TempZones.h"
 #include "Config.h"
+#include "ds18b20.h"
+#include "Usage.h"
+#include "Recorder.h"
+#include "Capture.h"
 #include "dump.h"
+#include "mem_util.h"
+#include "profile.h"
+#include "Watchdog.h"
+#include "Idle.h"
 #include "xprint.h"
 
-boolean printConfigTemp(char code, Config::temp_t temp, boolean first) {
+boolean printConfigTemp(FmtLine& line, char code, Config::temp_t temp, boolean first) {
   if (!temp.valid())
     return first;
   if (!first)
-    print(' ');  
-  print(code);
-  print(temp);
+    line.print(' ');  
+  printFmtOn_C(line, "%%", code, temp);
   return false;
 }
 
-void makeConfigDump() {
-  waitPrint();
-  print_C("[CC M");
-  print(config.mode.read(), DEC);
-  print_C(" H");
-  print(config.hotwater.read(), DEC);
-  print_C(" F");
-  print(config.force.read(), DEC);
-  print_C(" P");
-  print(config.period.read(), DEC);
-  print_C(" D");
-  print(config.duration.read(), DEC);
+void makeConfigDump(Print& out, Config& config) {
+  FmtLine line(out);
+  printFmtOn_C(line, "[CC M% H% F% P% D% E%", config.mode.read(), config.hotwater.read(), config.force.read(),
+    config.period.read(), config.duration.read(), config.corridor.read());
+  if (config.reportSeq.read() == 1)
+    printOn_C(line, " Q1");
+  if (config.slotNode.read() < config.slotCount.read())
+    printFmtOn_C(line, " N%:%", config.slotNode.read(), config.slotCount.read());
+  Config::temp_t reportTemp = config.reportTemp.read();
+  if (reportTemp.valid())
+    printFmtOn_C(line, " A{N% X% R%}", config.reportMin.read(), config.reportMax.read(), reportTemp);
   for (byte i = 0; i < TempZones::N_ZONES; i++) {
     Config::Zone& zone = config.zone[i];
     Config::temp_t ta = zone.tempA.read();
     Config::temp_t tb = zone.tempB.read();
     Config::temp_t tp = zone.tempP.read();
     if (ta.valid() || tb.valid() || tp.valid()) {
-      print_C(" T");
-      print(i, DEC);
-      print('{');
+      printFmtOn_C(line, " T%{", i);
       boolean first = true;
-      first = printConfigTemp('A', ta, first);
-      first = printConfigTemp('B', tb, first);
-      first = printConfigTemp('P', tp, first);
-      print('}');
+      first = printConfigTemp(line, 'A', ta, first);
+      first = printConfigTemp(line, 'B', tb, first);
+      first = printConfigTemp(line, 'P', tp, first);
+      line.print('}');
     }
   }
-  print_C("]*\r\n");
+  for (byte i = 0; i < DS18B20::MAX_SENSORS; i++) {
+    Config::Sensor& sensor = config.sensor[i];
+    if (sensor.rom[0].read() == DS18B20::FAMILY) {
+      printFmtOn_C(line, " S%{", i);
+      for (byte k = 0; k < DS18B20::ROM_SIZE; k += 2)
+        printFmtOn_C(line, "%%", FmtArg::hex(sensor.rom[k].read(), 2), FmtArg::hex(sensor.rom[k + 1].read(), 2));
+      byte zone = sensor.zone.read();
+      if (zone < TempZones::N_ZONES)
+        printFmtOn_C(line, ":%", zone);
+      line.print('}');
+    }
+  }
+  printOn_C(line, "]*\r\n");
+}
+
+void makeZonesDump(Print& out, TempZones& zones) {
+  FmtLine line(out);
+  printOn_C(line, "[CZ");
+  for (byte i = 0; i < TempZones::N_ZONES; i++) {
+    TempZones::temp_t temp = zones.get(i);
+    if (temp.valid())
+      printFmtOn_C(line, " %:%", i, temp);
+  }
+  printOn_C(line, "]*\r\n");
 }
 
-void makeZonesDump() {
-  waitPrint();
-  print_C("[CZ");
+void makeInfoDump(Print& out, Sensor& sensor, TempZones& zones) {
+  FmtLine line(out);
+  printOn_C(line, "[CI");
+  sensor.printInfo(line);
   for (byte i = 0; i < TempZones::N_ZONES; i++) {
-    TempZones::temp_t temp = tempZones.temp[i].get();
-    if (temp.valid()) {
-      print(' ');
-      print(i, DEC);
-      print(':');
-      print(temp);
+    TempZones::Stats& stats = zones.stats[i];
+    if (stats.packets != 0 || stats.expired != 0) {
+      printFmtOn_C(line, " Z%{N% X%", i, stats.packets, stats.expired);
+      if (stats.packets > 1)
+        printFmtOn_C(line, " I%/%/%", stats.minGap, stats.avgGap, stats.maxGap);
+      line.print('}');
     }
   }
-  print_C("]*\r\n");
+  if (watchdog.stalls() != 0)
+    printFmtOn_C(line, " W{N% S%}", watchdog.stalls(), watchdog.stalledStage());
+  printFmtOn_C(line, " M{S% F% K%} L%", staticRamSize(), freeRamMin(), stackPeak(), idle.percent());
+  printOn_C(line, "]*\r\n");
+}
+
+void makeTrendsDump(Print& out, Trend* trend, byte count) {
+  FmtLine line(out);
+  printOn_C(line, "[CR");
+  for (byte i = 0; i < count; i++) {
+    if (trend[i].count() == 0)
+      continue;
+    printFmtOn_C(line, " %{N% M% S% D%}", trend[i].minutes(), trend[i].count(), trend[i].mean(), trend[i].slope(),
+      trend[i].deviation());
+  }
+  printOn_C(line, "]*\r\n");
+}
+
+/**
+ * Prints usage as [CU H <hour> ... <current> D <day> ... <current>]* where each hour and each day
+ * lists minutes for all Usage categories in hex, 2 digits per hour and 3 digits per day.
+ * The oldest ones go first.
+ */
+void makeUsageDump(Print& out, Usage& usage) {
+  FmtLine line(out);
+  usage.snapshot();
+  printOn_C(line, "[CU H");
+  for (byte i = 0; i <= usage.hours(); i++) {
+    line.print(' ');
+    for (byte c = 0; c < Usage::N_CATEGORIES; c++)
+      printFmtOn_C(line, "%", FmtArg::hex(i < usage.hours() ? usage.hour(i, c) : usage.currentHour(c), 2));
+  }
+  printOn_C(line, " D");
+  for (byte i = 0; i <= usage.days(); i++) {
+    line.print(' ');
+    for (byte c = 0; c < Usage::N_CATEGORIES; c++)
+      printFmtOn_C(line, "%", FmtArg::hex(i < usage.days() ? usage.day(i, c) : usage.currentDay(c), 3));
+  }
+  printOn_C(line, "]*\r\n");
+}
+
+static void printRecorderItem(FmtLine& line, Recorder::Item& item) {
+  printFmtOn_C(line, " %%%", item.dt(), item.work() ? 'w' : ':', item.temp);
+}
+
+/**
+ * Prints kept history samples as [CL I<interval> <dt><w|:><temp> ... <last>]* where interval is
+ * the history interval of the profile in seconds, dt is the number of history intervals since the
+ * previous sample and 'w' marks samples when heater was working. The oldest ones go first and the
+ * last one is the latest sample that was not kept yet.
+ */
+void makeRecorderDump(Print& out, Recorder& recorder) {
+  FmtLine line(out);
+  printFmtOn_C(line, "[CL I%", (int)(Profile::HISTORY_INTERVAL / Timeout::SECOND));
+  for (byte i = 0; i < recorder.size(); i++)
+    printRecorderItem(line, recorder.get(i));
+  if (recorder.size() != 0 && recorder.last().dt() != 0)
+    printRecorderItem(line, recorder.last());
+  printOn_C(line, "]*\r\n");
+}
+
+/**
+ * Prints captured inputs as [CX <reason> T<time> L<size>:<records>]* where reason is the freeze
+ * reason or '-' when capture was not frozen, time is millis() of the last record, and records are
+ * size bytes of the binary ring (see Capture.h), the oldest first. Capture is re-armed.
+ */
+void makeCaptureDump(Print& out, Capture& capture) {
+  FmtLine line(out);
+  char reason = capture.reason();
+  capture.freeze('X'); // keep records still while printing
+  printFmtOn_C(line, "[CX % T% L%:", reason != 0 ? reason : '-', (long)capture.time(), capture.size());
+  capture.write(line);
+  printOn_C(line, "]*\r\n");
+  capture.rearm();
 }
@@ -1,7 +1,22 @@
 #ifndef DUMP_H_
 #define DUMP_H_
 
-void makeConfigDump();
-void makeZonesDump();
+#include "Config.h"
+#include "Sensor.h"
+#include "Trend.h"
+#include "TempZones.h"
+#include "Usage.h"
+#include "Recorder.h"
+#include "Capture.h"
+
+// Dumps print to out right away, each through one FmtLine, reserve it first with Hal::waitPrint
+
+void makeConfigDump(Print& out, Config& config);
+void makeZonesDump(Print& out, TempZones& zones);
+void makeInfoDump(Print& out, Sensor& sensor, TempZones& zones);
+void makeTrendsDump(Print& out, Trend* trend, byte count);
+void makeUsageDump(Print& out, Usage& usage);
+void makeRecorderDump(Print& out, Recorder& recorder);
+void makeCaptureDump(Print& out, Capture& capture);
 
 #endif /* DUMP_H_ */
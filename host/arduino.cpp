@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include "host.h"
+
+// ----------- time -----------
+
+unsigned long long hostMicros; // of the Arduino core, nodes have their own clock in Host::Board
+
+unsigned long millis() {
+  hostMicros += Host::CALL_MICROS;
+  return hostMicros / 1000;
+}
+
+unsigned long micros() {
+  hostMicros += Host::CALL_MICROS;
+  return hostMicros;
+}
+
+void delay(unsigned long ms) {
+  hostMicros += (unsigned long long)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostMicros += us;
+}
+
+// ----------- pins -----------
+
+volatile uint8_t SREG;
+
+int analogRead(uint8_t pin) {
+  return 0;
+}
+
+int digitalRead(uint8_t pin) {
+  return HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+// ----------- random -----------
+
+unsigned long randomState = 1;
+
+void randomSeed(unsigned long seed) {
+  randomState = seed;
+}
+
+long random(long howbig) {
+  if (howbig <= 0)
+    return 0;
+  randomState = randomState * 1103515245 + 12345;
+  return (randomState >> 8) % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+// ----------- print -----------
+
+size_t Print::write(const char* s) {
+  return write((const uint8_t*)s, strlen(s));
+}
+
+size_t Print::write(const uint8_t* buf, size_t size) {
+  size_t n = 0;
+  while (size-- > 0)
+    n += write(*buf++);
+  return n;
+}
+
+size_t Print::print(const char* s) {
+  return write(s);
+}
+
+size_t Print::print(char c) {
+  return write(c);
+}
+
+size_t Print::print(unsigned char x, int base) {
+  return print((unsigned long)x, base);
+}
+
+size_t Print::print(int x, int base) {
+  return print((long)x, base);
+}
+
+size_t Print::print(unsigned int x, int base) {
+  return print((unsigned long)x, base);
+}
+
+size_t Print::print(long x, int base) {
+  if (base == DEC || x >= 0) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%ld", x);
+    return write(buf);
+  }
+  return print((unsigned long)x, base);
+}
+
+size_t Print::print(unsigned long x, int base) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%lu", x);
+  return write(buf);
+}
+
+size_t Print::println(const char* s) {
+  return print(s) + println();
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+// ----------- serial -----------
+
+Host::Link::Link() : _pos(0), _output(0) {}
+
+void Host::Link::input(const char* s) {
+  if (_pos == _input.size()) {
+    _input.clear();
+    _pos = 0;
+  }
+  _input += s;
+}
+
+void Host::Link::output(Print* out) {
+  _output = out;
+}
+
+int Host::Link::available() {
+  return _input.size() - _pos;
+}
+
+int Host::Link::read() {
+  return _pos < _input.size() ? (byte)_input[_pos++] : -1;
+}
+
+int Host::Link::peek() {
+  return _pos < _input.size() ? (byte)_input[_pos] : -1;
+}
+
+size_t Host::Link::write(uint8_t c) {
+  return _output ? _output->write(c) : 1;
+}
+
+HardwareSerial Serial;
+
+Host::Link serialLink;
+
+void Host::input(const char* s) {
+  serialLink.input(s);
+}
+
+void Host::output(Print* out) {
+  serialLink.output(out);
+}
+
+void HardwareSerial::begin(unsigned long baud) {}
+
+int HardwareSerial::available() {
+  return serialLink.available();
+}
+
+int HardwareSerial::read() {
+  return serialLink.read();
+}
+
+int HardwareSerial::peek() {
+  return serialLink.peek();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return serialLink.write(c);
+}
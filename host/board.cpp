@@ -0,0 +1,96 @@
+#include "host.h"
+#include "blink_led.h"
+#include "Watchdog.h"
+#include "Idle.h"
+#include "mem_util.h"
+
+/*
+ * Host version of the board: the heater panel state, forced turn on, mode change commands, presets,
+ * and the clock of each node are kept in its Host::Board. The MCU diagnostics do nothing on the host.
+ */
+
+Host::Board::Board() :
+  panelMode(State::MODE_UNKNOWN),
+  scan(0),
+  error(false),
+  turnedOn(false),
+  forceOn(false),
+  tempKnob(0),
+  timeKnob(0),
+  modeTimes(),
+  _micros(0),
+  _random(1)
+{}
+
+unsigned long Host::Board::time() {
+  return _micros / 1000;
+}
+
+void Host::Board::advance(unsigned long ms) {
+  _micros += (unsigned long long)ms * 1000;
+}
+
+void Host::Board::setMode(State::Mode mode) {
+  if (mode != panelMode)
+    modeTimes[mode] = millis();
+  panelMode = mode;
+}
+
+byte Host::Board::errorBits() {
+  return error ? 1 : 0;
+}
+
+byte Host::Board::activeBits() {
+  return ((scan >> State::ACTIVE_LED) & 1) | ((forceOn || turnedOn) << 1);
+}
+
+byte Host::Board::state() {
+  byte state = scan & ~(1 << State::ERROR_LED);
+  state |= errorBits() << State::ERROR_LED;
+  state |= (activeBits() >> 1) << State::ACTIVE_SIGNAL;
+  return state;
+}
+
+unsigned long Host::Board::millis() {
+  _micros += CALL_MICROS;
+  return _micros / 1000;
+}
+
+long Host::Board::random(long howsmall, long howbig) {
+  if (howsmall >= howbig)
+    return howsmall;
+  _random = _random * 1103515245 + 12345; // same generator as random() of arduino.cpp
+  return howsmall + (long)((_random >> 8) % (howbig - howsmall));
+}
+
+// ----------- watchdog, idle, mem_util -----------
+
+Watchdog watchdog;
+
+boolean Watchdog::setup() {
+  return false;
+}
+
+void Watchdog::stage(Stage s) {}
+
+void Watchdog::loopDone() {}
+
+Idle idle;
+
+void Idle::sleep() {}
+
+byte Idle::percent() {
+  return 0;
+}
+
+unsigned int staticRamSize() {
+  return 0;
+}
+
+unsigned int stackPeak() {
+  return 0;
+}
+
+unsigned int freeRamMin() {
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <type_traits>
+#include "host.h"
+#include "FixNum.h"
+
+/*
+ * Tests of FixNum arithmetic and conversions: result types and precisions picked at compile time,
+ * saturation of overflows to the invalid sentinels, propagation of invalid operands, rounding of
+ * division and precision changes. Limits are taken from FixNumUtil::Limits, so the same checks
+ * hold for 16-bit int on the board and 32-bit int on the host.
+ */
+
+typedef FixNum<byte, 1> b1;
+typedef FixNum<int, 0>  i0;
+typedef FixNum<int, 1>  i1;
+typedef FixNum<int, 2>  i2;
+typedef FixNum<long, 2> l2;
+
+const int  IMAX = FixNumUtil::Limits<int>::maxValue;
+const int  IMIN = FixNumUtil::Limits<int>::minValue;
+const long LMAX = FixNumUtil::Limits<long>::maxValue;
+
+int failures = 0;
+
+#define CHECK(cond) check(cond, #cond, __LINE__)
+
+void check(bool ok, const char* what, int line) {
+  if (!ok) {
+    printf("FAILED line %d: %s\n", line, what);
+    failures++;
+  }
+}
+
+template<typename T, byte prec> bool is(FixNum<T, prec> x, T mantissa) {
+  return x.mantissa() == mantissa;
+}
+
+// Conversion as done by assignment in the firmware
+template<typename R, typename T, byte prec> R to(FixNum<T, prec> x) {
+  R r = x;
+  return r;
+}
+
+template<typename T, byte prec> bool invalid(FixNum<T, prec> x) {
+  return !x.valid();
+}
+
+void testResultTypes() {
+  static_assert(std::is_same<decltype(i2() + i1()), i2>::value, "int,2 + int,1 is int,2");
+  static_assert(std::is_same<decltype(i1() - i2()), i2>::value, "int,1 - int,2 is int,2");
+  static_assert(std::is_same<decltype(b1() + b1()), b1>::value, "byte,1 + byte,1 is byte,1");
+  static_assert(std::is_same<decltype(b1() - i0()), i1>::value, "byte,1 - int,0 is int,1");
+  static_assert(std::is_same<decltype(i2() + l2()), l2>::value, "int,2 + long,2 is long,2");
+  static_assert(std::is_same<decltype(i1() * 3), i1>::value, "scalar product keeps the type");
+  static_assert(std::is_same<decltype(i1() / 3), i1>::value, "scalar quotient keeps the type");
+}
+
+void testArithmetic() {
+  CHECK(is(i2(125) + i1(25), 375));  // 1.25 + 2.5
+  CHECK(is(i1(25) - i2(125), 125));  // 2.5 - 1.25
+  CHECK(is(b1(200) - i0(21), -10));  // 20.0 - 21
+  CHECK(is(i2(-150) + i2(50), -100));
+  CHECK(is(i1(12) * -3, -36));
+  CHECK(is(i2(100) / 4, 25));
+}
+
+void testSaturation() {
+  CHECK(invalid(i0(IMAX - 1) + i0(1)));
+  CHECK(is(i0(IMAX - 1) + i0(5), IMAX));
+  CHECK(is(i0(IMIN + 1) + i0(-5), IMIN));
+  CHECK(is(i0(IMIN + 1) - i0(5), IMIN));
+  CHECK(is(i0(IMAX - 1) - i0(-5), IMAX));
+  CHECK(is(i0(IMAX - 2) + i0(1), IMAX - 1)); // the largest valid value
+  CHECK(is(i0(IMAX / 2 + 1) * 2, IMAX));
+  CHECK(is(i0(IMAX / 2 + 1) * -2, IMIN));
+  CHECK(is(l2(LMAX / 3 + 1) * 3, LMAX));
+  CHECK(is(l2(LMAX / 3 + 1) * -3, -LMAX));
+  CHECK(is(b1(200) + b1(100), (byte)255)); // byte saturates to its invalid 25.5
+  CHECK(invalid(b1(200) + b1(100)));
+}
+
+void testInvalid() {
+  CHECK(invalid(i1() + i1(1)));
+  CHECK(invalid(i1(1) + i1()));
+  CHECK(invalid(i1() - i2(1)));
+  CHECK(invalid(i2(1) - i1()));
+  CHECK(invalid(i1(IMIN) + i1(1)));  // min sentinel is invalid as well
+  CHECK(invalid(i1() * 0));
+  CHECK(invalid(i1() / 1));
+  CHECK(invalid(i1(10) / 0));
+  CHECK(!(i1() == i1()));  // comparisons with invalid are all false
+  CHECK(!(i1() != i1(1)));
+  CHECK(!(i1() < i1(1)));
+  CHECK(!(i1(1) >= i1()));
+}
+
+void testDivision() {
+  CHECK(is(i0(7) / 2, 4));   // 3.5
+  CHECK(is(i0(-7) / 2, -4));
+  CHECK(is(i0(7) / -2, -4));
+  CHECK(is(i0(5) / 3, 2));   // 1.67
+  CHECK(is(i0(4) / 3, 1));   // 1.33
+  CHECK(is(i0(-4) / 3, -1));
+}
+
+void testConversion() {
+  CHECK(is(to<i1>(i2(1234)), 123));  // 12.34 -> 12.3
+  CHECK(is(to<i1>(i2(1235)), 124));  // 12.35 -> 12.4
+  CHECK(is(to<i1>(i2(-1235)), -124));
+  CHECK(is(to<i1>(i2(-1234)), -123));
+  CHECK(is(to<i2>(i1(12)), 120));
+  CHECK(is(to<i2>(b1(200)), 2000));
+  CHECK(invalid(to<i1>(i0(IMAX / 10 + 1)))); // scaling up saturates
+  CHECK(invalid(to<i1>(i0(-(IMAX / 10) - 1))));
+  CHECK(invalid(to<b1>(i1(300))));           // narrowing saturates
+  CHECK(invalid(to<b1>(i1(-5))));
+  CHECK(is(to<b1>(i2(1234)), (byte)123));
+  CHECK(invalid(to<i2>(b1())));              // invalid stays invalid when widened
+  CHECK(invalid(to<i1>(i2())));
+  CHECK(invalid(to<i0>(l2(LMAX))));
+  CHECK(i2(150) == b1(15));                  // comparisons scale to the larger precision
+  CHECK(i2(151) > b1(15));
+  CHECK(i1(-1) < i2(-5));
+}
+
+int main() {
+  testResultTypes();
+  testArithmetic();
+  testSaturation();
+  testInvalid();
+  testDivision();
+  testConversion();
+  if (failures != 0) {
+    printf("%d FixNum checks failed\n", failures);
+    return 1;
+  }
+  printf("OK FixNum\n");
+  return 0;
+}
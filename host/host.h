@@ -0,0 +1,89 @@
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <Arduino.h>
+#include <string>
+#include "state_hal.h"
+#include "Hal.h"
+
+/*
+ * Controls of the host build. Time is virtual and each node has its own clock: the driver moves it
+ * forward between inputs and each millis() call adds CALL_MICROS, so busy waits (like waitPrint) end
+ * in virtual time too. Board inputs that the heater panel and the pins give on the device are set
+ * in the Board of the node. Serial of the Arduino core is only used by the reference parser.
+ */
+namespace Host {
+  const unsigned int CALL_MICROS = 10;
+
+  /** Heater panel, presets, and clock of one node. */
+  class Board : public Hal {
+  public:
+    State::Mode   panelMode;
+    byte          scan;     // scanned panel LEDs as State::xxx_LED bits (without ACTIVE_SIGNAL)
+    boolean       error;    // debounced error
+    boolean       turnedOn; // heater turned on by itself (not forced)
+    boolean       forceOn;
+    int           tempKnob; // preset temperature knob
+    int           timeKnob; // preset time knob
+    unsigned long modeTimes[MAX_MODE + 1];
+
+    Board();
+
+    unsigned long time();           // virtual time in ms
+    void advance(unsigned long ms); // moves virtual time forward
+    void setMode(State::Mode mode); // mode change seen on the panel
+
+    virtual State::Mode mode() { return panelMode; }
+    virtual byte state();
+    virtual byte activeBits();
+    virtual byte errorBits();
+    virtual unsigned long modeTime(State::Mode mode) { return modeTimes[mode]; }
+    virtual void changeMode(State::Mode mode) { setMode(mode); } // the panel follows the command right away
+    virtual void setForceOn(boolean on) { forceOn = on; }
+    virtual boolean isForceOn() { return forceOn; }
+    virtual int presetTemp() { return tempKnob; }
+    virtual int presetTime() { return timeKnob; }
+    virtual unsigned long millis();
+    virtual long random(long howsmall, long howbig);
+
+  private:
+    unsigned long long _micros;
+    unsigned long      _random;
+  };
+
+  /** Serial link of one node: input queued by the driver, output passed on. */
+  class Link : public Stream {
+  public:
+    Link();
+
+    void input(const char* s); // appends to input
+    void output(Print* out);   // output goes there, nowhere when null
+
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual size_t write(uint8_t c);
+    using Print::write;
+
+  private:
+    std::string _input;
+    size_t      _pos;
+    Print*      _output;
+  };
+
+  void input(const char* s);      // appends to input of Serial
+  void output(Print* out);        // output of Serial goes there, nowhere when null
+}
+
+/** Print into string. */
+class StringPrint : public Print {
+public:
+  std::string text;
+
+  virtual size_t write(uint8_t c) {
+    text += (char)c;
+    return 1;
+  }
+};
+
+#endif /* HOST_H_ */
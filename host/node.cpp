@@ -0,0 +1,74 @@
+#include "node.h"
+
+// Raw DS18B20 read (1/16 deg C) that gives the value of the simulated sensor
+int rawTemp(Sensor::temp_t t) {
+  if (!t.valid())
+    return Capture::NO_TEMP;
+  int m = t.mantissa();
+  return m >= 0 ? (m * 16 + 99) / 100 : -((-m * 16 + 99) / 100);
+}
+
+Node::Node(const Controller::ResetLimits& resetLimits) :
+  sensor(0),
+  _force(board, config, _zones),
+  _zones(board, _force),
+  _recorder(config),
+  _reportLog(board, _link),
+  _slots(board, config),
+  _usage(board),
+  _capture(board),
+  _parser(_link, _link, board, config, _zones, _force, _reportLog, _capture),
+  _controller(board, _link, sensor, config, _zones, _force, _recorder, _reportLog, _slots, _usage, _capture,
+    resetLimits),
+  _capturedTemp(Capture::NO_TEMP),
+  _capturedState(0),
+  _capturedTurnedOn(false),
+  _capturedPresetTemp(-1),
+  _capturedPresetTime(-1)
+{
+  memset((void*)&config, 0xff, sizeof(Config)); // unprogrammed EEPROM
+  _sensors[0] = &sensor;
+}
+
+// Records changed inputs like the board modules do when they read them
+void Node::captureInputs() {
+  int raw = rawTemp(sensor.value(0));
+  if (raw != _capturedTemp) {
+    _capturedTemp = raw;
+    _capture.add(Capture::TEMP, raw);
+  }
+  byte state = board.scan | (board.error << State::ERROR_LED);
+  if (state != _capturedState) {
+    _capturedState = state;
+    _capture.add(Capture::STATE, state);
+  }
+  if (board.turnedOn != _capturedTurnedOn) {
+    _capturedTurnedOn = board.turnedOn;
+    _capture.add(Capture::ANALOG | Capture::ANALOG_TURNED_ON, (int)_capturedTurnedOn);
+  }
+  if (board.tempKnob != _capturedPresetTemp) {
+    _capturedPresetTemp = board.tempKnob;
+    _capture.add(Capture::ANALOG | Capture::ANALOG_PRESET_TEMP, _capturedPresetTemp);
+  }
+  if (board.timeKnob != _capturedPresetTime) {
+    _capturedPresetTime = board.timeKnob;
+    _capture.add(Capture::ANALOG | Capture::ANALOG_PRESET_TIME, _capturedPresetTime);
+  }
+}
+
+void Node::loop() {
+  captureInputs();
+  readSensors(_sensors, 1, _zones);
+  _zones.check();
+  _controller.check();
+  _controller.execute(_parser.parseCommand());
+  if (_force.check())
+    _controller.makeDump(Controller::DUMP_FORCED_ON);
+  _usage.check();
+  _reportLog.check();
+}
+
+void Node::drain() {
+  while (_link.available() > 0)
+    loop();
+}
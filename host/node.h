@@ -0,0 +1,84 @@
+#ifndef NODE_H_
+#define NODE_H_
+
+#include "host.h"
+#include "Config.h"
+#include "TempZones.h"
+#include "Force.h"
+#include "Recorder.h"
+#include "ReportLog.h"
+#include "Slots.h"
+#include "Usage.h"
+#include "Capture.h"
+#include "parse.h"
+#include "Controller.h"
+#include "SimSensor.h"
+
+/**
+ * Controller node of the host build: the main loop of c_main.cpp around a Controller with the heater
+ * panel and the clock in its board and a simulated local sensor of zone 0. The node owns all firmware
+ * modules the controller works with, its config starts as unprogrammed EEPROM, and its serial link is
+ * fed by the driver, so any number of nodes may run in one process.
+ */
+class Node {
+public:
+  Host::Board board;  // heater panel and clock
+  Config      config; // EEPROM
+  SimSensor   sensor; // local sensor of zone 0, set it before loop()
+
+  Node(const Controller::ResetLimits& resetLimits = Controller::DEFAULT_RESET_LIMITS);
+
+  void input(const char* s); // appends to serial input
+  void output(Print* out);   // serial output goes there, nowhere when null
+
+  TempZones& zones();
+  Capture& capture();
+
+  /** Runs one iteration of the firmware main loop. */
+  void loop();
+
+  /** Runs the loop until all serial input is consumed. */
+  void drain();
+
+private:
+  Host::Link _link;
+  Force      _force;
+  TempZones  _zones;
+  Recorder   _recorder;
+  ReportLog  _reportLog;
+  Slots      _slots;
+  Usage      _usage;
+  Capture    _capture;
+  Parser     _parser;
+  Sensor*    _sensors[1];
+  Controller _controller;
+
+  // last captured inputs
+  int        _capturedTemp; // raw read in 1/16 deg C
+  byte       _capturedState;
+  boolean    _capturedTurnedOn;
+  int        _capturedPresetTemp;
+  int        _capturedPresetTime;
+
+  Node(const Node& other); // no copy constructor
+
+  void captureInputs();
+};
+
+inline void Node::input(const char* s) {
+  _link.input(s);
+}
+
+inline void Node::output(Print* out) {
+  _link.output(out);
+}
+
+inline TempZones& Node::zones() {
+  return _zones;
+}
+
+inline Capture& Node::capture() {
+  return _capture;
+}
+
+#endif /* NODE_H_ */
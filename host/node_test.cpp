@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <string>
+#include "host.h"
+#include "node.h"
+
+/*
+ * Tests that controller nodes stepped side by side in one process keep their state separate: each
+ * of them prints exactly what the same node prints when it runs alone (dumps, acks, capture), and
+ * config, zones, and force of one do not leak into the other.
+ */
+
+const unsigned long LOOP_INTERVAL = 1000;    // firmware loop runs every second of virtual time
+const unsigned long STEPS = 3 * 60 * 60;     // 3 hours of loops
+const unsigned long PACKET_STEPS = 60;       // a zone packet every minute
+const char FINAL_DUMPS[] = "!CC\r\n!CZ\r\n!CX\r\n";
+
+struct Setup {
+  State::Mode mode;
+  int         temp; // local sensor (1/100 deg C)
+  const char* commands;
+  const char* packet;
+};
+
+// A heats in WORKING mode and is forced on by a cold zone, B is off and gets no packets
+const Setup A = { State::MODE_WORKING, 4000, "!CH90\r\n!CF2\r\n!CT1A20\r\n!C#1:?\r\n", "[1:15.0]\r\n" };
+const Setup B = { State::MODE_OFF, 6000, "!CH30\r\n!CF0\r\n!C#7:?\r\n", "" };
+
+int failures = 0;
+
+#define CHECK(cond) check(cond, #cond, __LINE__)
+
+void check(bool ok, const char* what, int line) {
+  if (!ok) {
+    printf("FAILED line %d: %s\n", line, what);
+    failures++;
+  }
+}
+
+void start(Node& node, const Setup& setup, StringPrint& out) {
+  node.output(&out);
+  node.board.setMode(setup.mode);
+  node.sensor.set(Sensor::temp_t(setup.temp));
+  node.input(setup.commands);
+}
+
+void step(Node& node, const Setup& setup, unsigned long i) {
+  if (i % PACKET_STEPS == 0)
+    node.input(setup.packet);
+  node.loop();
+  node.board.advance(LOOP_INTERVAL);
+}
+
+void finish(Node& node) {
+  node.input(FINAL_DUMPS);
+  node.drain();
+  node.output(0);
+}
+
+// Output of a node that runs alone
+std::string alone(const Setup& setup) {
+  Node node;
+  StringPrint out;
+  start(node, setup, out);
+  for (unsigned long i = 0; i < STEPS; i++)
+    step(node, setup, i);
+  finish(node);
+  return out.text;
+}
+
+int main() {
+  Node a;
+  Node b;
+  StringPrint outA;
+  StringPrint outB;
+  start(a, A, outA);
+  start(b, B, outB);
+  for (unsigned long i = 0; i < STEPS; i++) {
+    step(a, A, i);
+    step(b, B, i);
+  }
+  CHECK(a.config.hotwater.read() == 90);
+  CHECK(b.config.hotwater.read() == 30);
+  CHECK(a.zones().get(1) == TempZones::temp_t(150));
+  CHECK(!b.zones().get(1).valid());
+  CHECK(a.board.forceOn);
+  CHECK(!b.board.forceOn);
+  finish(a);
+  finish(b);
+  CHECK(outA.text.find("[C+1]*") != std::string::npos);
+  CHECK(outB.text.find("[C+7]*") != std::string::npos);
+  CHECK(outA.text.find("[CX ") != std::string::npos);
+  CHECK(outA.text == alone(A));
+  CHECK(outB.text == alone(B));
+  if (failures != 0) {
+    printf("%d Node checks failed\n", failures);
+    return 1;
+  }
+  printf("OK Node (2 nodes side by side, %lu loops each)\n", STEPS);
+  return 0;
+}
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include "host.h"
+#include "Config.h"
+#include "parse.h"
+#include "parse_ref.h"
+
+/*
+ * Per-byte throughput of the grammar-table parser (parse.cpp) and the reference state machine
+ * (parse_ref.cpp) on typical traffic: dump lines of other controllers on the shared serial link,
+ * commands, and zone packets. Host times only compare the two, they do not predict AVR cycles.
+ * Usage: parse_bench [<megabytes per traffic kind>]
+ */
+
+struct Traffic {
+  const char* name;
+  const char* text;
+};
+
+const Traffic TRAFFIC[] = {
+  { "foreign", "[C:1 +45.20 e0o0z0;s0100001 d+0.00p55.0q1.0w00i000-0.0a000+0.0u00000020#00001]*\r\n"
+               "[CZ 1:21.5 2:19.0]*\r\n!RR\r\n{C:ControlHeater started}*\r\n" },
+  { "commands", "!C?\r\n!CZ\r\n!CH90\r\n!CT3A21.5\r\n!CS2:5\r\n!CAN30\r\n!CAR0.5\r\n!C#12:!CP240\r\n!CB117\r\n" },
+  { "packets", "[3:21.5]\r\n[2:19,4:-1.5,5:22.25]\r\n[1:20.5,2:21#b6]\r\n" },
+};
+
+template<typename Parse> double measure(Parse parse, const std::string& text) {
+  int sink = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < text.size(); i++)
+    sink += parse(text[i]);
+  std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+  if (sink == 1)
+    printf(" "); // keeps results used
+  return time.count() / text.size();
+}
+
+int main(int argc, char** argv) {
+  double megabytes = argc > 1 ? atof(argv[1]) : 4;
+  printf("%-10s %12s %12s\n", "traffic", "table ns/B", "ref ns/B");
+  for (size_t k = 0; k < sizeof(TRAFFIC) / sizeof(TRAFFIC[0]); k++) {
+    std::string text;
+    while (text.size() < megabytes * 1000000)
+      text += TRAFFIC[k].text;
+    double reference = measure(ref::parseChar, text);
+    Parser parser(Serial, Serial, board, config, tempZones, force, reportLog, capture); // fresh state for each traffic kind
+    double table = measure([&](char ch) { return parser.parseChar(ch); }, text);
+    printf("%-10s %12.2f %12.2f\n", TRAFFIC[k].name, table, reference);
+  }
+  return 0;
+}
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <string>
+#include "host.h"
+#include "Config.h"
+#include "TempZones.h"
+#include "parse.h"
+#include "parse_ref.h"
+
+/*
+ * Differential test of the grammar-table parser (parse.cpp) against the hand-written state machine
+ * it replaced (parse_ref.cpp). Both parse the same random mix of valid, truncated, and corrupted
+ * commands, frames, and packets from a fresh config, and they must return the same commands after
+ * the same input bytes, leave the same config and zone temperatures after each command, and print
+ * the same acks. The random input stays within the grammar both parsers share, the intentional
+ * divergences are checked one by one in DIVERGENCES. Usage: parse_diff [<pieces> [<seed>]]
+ */
+
+struct Divergence {
+  const char* what;
+  const char* input;
+  const char* table; // returned commands and hotwater after input, see outcome()
+  const char* ref;
+};
+
+const Divergence DIVERGENCES[] = {
+  { "byte argument that overflows is rejected, not saturated",
+    "!CH300\r",                          "H0",    "=H255" },
+  { "!CX dumps capture",
+    "!CX\r",                             "XH0",   "H0" },
+  { "index without the rest of command is rejected",
+    "!CT1\r!CS1\r!CN1\r",                "H0",    "===H0" },
+  { "retried frame is detected before it has any effect",
+    "!C#5:H7\r!C#5:H9\r",                "H7",    "H9" },
+  { "frame far from the newest one (gateway restart) forgets recent frames",
+    "!C#6:?!C#30:?!C#6:?",               "???H0", "??H0" },
+  { "!CQ opts in to sequence numbers in state dumps",
+    "!CQ1\r",                            "=H0",   "H0" },
+};
+
+// The reference saturates byte arguments to 255 once they exceed 24 before the last digit
+const unsigned int MAX_BYTE_ARG = 250;
+
+unsigned long seed;
+unsigned int frameSeq = 100; // frames are numbered upwards from those of DIVERGENCES, so there are no retries
+
+// Deterministic generator, so a failure is reproduced with the same seed
+unsigned int rnd(unsigned int n) {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+std::string number(unsigned int max) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u", rnd(max));
+  return buf;
+}
+
+std::string temp() {
+  static const char* const TEMPS[] = { "21", "21.5", "-1.5", "+7.25", "0", "-0.1", "99.99", "327.67", "1e", "--1", "", " 3" };
+  return TEMPS[rnd(sizeof(TEMPS) / sizeof(TEMPS[0]))];
+}
+
+std::string eoln() {
+  static const char* const EOLNS[] = { "\r\n", "\r", "\n", "", "]" };
+  return EOLNS[rnd(sizeof(EOLNS) / sizeof(EOLNS[0]))];
+}
+
+std::string command() {
+  static const char CHARS[] = "?CZIRULG1234HFPDEATSNB#@V";
+  std::string s = "!C";
+  char c = CHARS[rnd(sizeof(CHARS) - 1)];
+  s += c;
+  switch (c) {
+    case 'A':
+      s += "NXRQ"[rnd(4)];
+      s += s[3] == 'R' ? temp() : number(MAX_BYTE_ARG);
+      break;
+    case 'T':
+      s += number(12);
+      s += "ABPQ"[rnd(4)];
+      s += temp();
+      break;
+    case 'S':
+    case 'N':
+      s += number(12) + ":" + number(MAX_BYTE_ARG); // index only is a divergence
+      break;
+    case 'B':
+      s += number(70000);
+      break;
+    case '#':
+      frameSeq += rnd(4) ? 1 : 1000;
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%u", frameSeq);
+      s += buf;
+      s += rnd(8) ? ":" : "";
+      return s + command().substr(2); // framed command without its own "!C"
+    default:
+      if (rnd(2))
+        s += number(MAX_BYTE_ARG);
+  }
+  return s + eoln();
+}
+
+std::string packet() {
+  std::string body;
+  byte zones = 1 + rnd(9);
+  for (byte i = 0; i < zones; i++)
+    body += (i > 0 ? "," : "") + number(12) + (rnd(8) ? ":" : " ") + temp(); // no digits after zone: overflow is a divergence
+  std::string s = "[" + body;
+  if (rnd(2)) {
+    byte sum = 0;
+    for (size_t i = 0; i < body.size(); i++)
+      sum += body[i];
+    char buf[8];
+    snprintf(buf, sizeof(buf), "#%02x", rnd(4) ? sum : sum + 1);
+    s += buf;
+  }
+  return s + (rnd(8) ? "]" : "") + eoln();
+}
+
+std::string noise() {
+  static const char* const LINES[] = {
+    "[C:1 +45.20 e0o0z0;s0100001 d+0.00p55.0q1.0w00i000-0.0a000+0.0u00000020#00001]*\r\n",
+    "{C:ControlHeater started}*\r\n", "!RR\r\n", "[CZ 1:21.5 2:19.0]*\r\n", "!", "!C", "[", "\r\n"
+  };
+  if (rnd(3))
+    return LINES[rnd(sizeof(LINES) / sizeof(LINES[0]))];
+  std::string s;
+  for (byte n = rnd(8); n > 0; n--) {
+    char c = 1 + rnd(127);
+    if (c == '!' || c == CMD_DUMP_CAPTURE || (s.empty() && c >= '0' && c <= '9'))
+      c = '?'; // keeps divergences out: !CX, also after noise "!C", and digits that extend a number
+    s += c;
+  }
+  return s;
+}
+
+std::string generate(unsigned long pieces) {
+  std::string s;
+  for (unsigned long i = 0; i < pieces; i++) {
+    std::string piece = rnd(3) == 0 ? noise() : rnd(2) ? command() : packet();
+    if (rnd(16) == 0) {
+      piece.resize(rnd(piece.size() + 1)); // truncated
+      piece += ' '; // and never completed by the next piece, e.g. '!CT1' with an eoln
+    }
+    s += piece;
+  }
+  return s;
+}
+
+// Results of parsing as text: each command with the number of bytes read, config, and zones after it
+template<typename Parse> std::string run(Parse parseCommand, StringPrint& out, const std::string& input,
+    unsigned long& commands) {
+  resetBoard();
+  Host::output(&out);
+  Host::input(input.c_str());
+  std::string result;
+  while (Serial.available()) {
+    char cmd = parseCommand();
+    if (cmd != 0)
+      commands++;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "@%lu %c E", (unsigned long)(input.size() - Serial.available()), cmd ? cmd : '0');
+    result += buf;
+    for (size_t i = 0; i < sizeof(Config); i++) {
+      snprintf(buf, sizeof(buf), "%02x", ((byte*)&config)[i]);
+      result += buf;
+    }
+    result += " Z";
+    for (byte i = 0; i < TempZones::N_ZONES; i++) {
+      snprintf(buf, sizeof(buf), " %d", tempZones.get(i).mantissa());
+      result += buf;
+    }
+    result += "\n";
+  }
+  Host::output(0);
+  return result + "OUT " + out.text + "\n";
+}
+
+// Prints the first differing line of results with the input that led to it
+void report(const std::string& input, const std::string& a, const std::string& b) {
+  size_t i = 0;
+  while (i < a.size() && i < b.size() && a[i] == b[i])
+    i++;
+  size_t start = a.rfind('\n', i) == std::string::npos ? 0 : a.rfind('\n', i) + 1;
+  std::string lineA = a.substr(start, a.find('\n', start) - start);
+  std::string lineB = b.substr(start, b.find('\n', start) - start);
+  unsigned long pos = strtoul(lineA.c_str() + 1, 0, 10);
+  unsigned long from = pos > 80 ? pos - 80 : 0;
+  std::string context = input.substr(from, pos - from);
+  for (size_t k = 0; k < context.size(); k++)
+    if ((byte)context[k] < ' ' || (byte)context[k] > '~')
+      context[k] = '.';
+  printf("MISMATCH after input ...%s\n table: %s\n   ref: %s\n", context.c_str(), lineA.c_str(), lineB.c_str());
+}
+
+// Commands returned from parsing input from a fresh config, and the hotwater setting after it
+template<typename Parse> std::string outcome(Parse parseCommand, const char* input) {
+  memset((void*)&config, 0, sizeof(Config));
+  StringPrint out;
+  Host::output(&out);
+  Host::input(input);
+  std::string result;
+  while (Serial.available()) {
+    char cmd = parseCommand();
+    if (cmd != 0)
+      result += cmd;
+  }
+  Host::output(0);
+  char buf[8];
+  snprintf(buf, sizeof(buf), "H%d", config.hotwater.read());
+  return result + buf;
+}
+
+boolean checkDivergences() {
+  boolean ok = true;
+  for (size_t i = 0; i < sizeof(DIVERGENCES) / sizeof(DIVERGENCES[0]); i++) {
+    const Divergence& d = DIVERGENCES[i];
+    StringPrint acks;
+    Parser table(Serial, acks, board, config, tempZones, force, reportLog, capture);
+    std::string tableResult = outcome([&]() { return table.parseCommand(); }, d.input);
+    std::string refResult = outcome(ref::parseCommand, d.input);
+    if (tableResult != d.table || refResult != d.ref) {
+      printf("DIVERGENCE %s\n table: %s (expected %s)\n   ref: %s (expected %s)\n",
+        d.what, tableResult.c_str(), d.table, refResult.c_str(), d.ref);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  if (!checkDivergences())
+    return 1;
+  unsigned long pieces = argc > 1 ? strtoul(argv[1], 0, 10) : 100000;
+  seed = argc > 2 ? strtoul(argv[2], 0, 10) : 1;
+  unsigned long startSeed = seed;
+  std::string input = generate(pieces);
+  unsigned long commands = 0;
+  unsigned long refCommands = 0;
+  StringPrint tableOut;
+  StringPrint refOut;
+  Parser table(Serial, tableOut, board, config, tempZones, force, reportLog, capture); // acks go to tableOut directly, the reference prints them to Serial
+  std::string tableResult = run([&]() { return table.parseCommand(); }, tableOut, input, commands);
+  std::string refResult = run(ref::parseCommand, refOut, input, refCommands);
+  if (tableResult != refResult) {
+    report(input, tableResult, refResult);
+    return 1;
+  }
+  printf("OK %lu pieces (%lu bytes, %lu commands, seed %lu), %u intentional divergences\n",
+    pieces, (unsigned long)input.size(), commands, startSeed,
+    (unsigned int)(sizeof(DIVERGENCES) / sizeof(DIVERGENCES[0])));
+  return 0;
+}
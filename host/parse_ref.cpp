@@ -0,0 +1,427 @@
+#include <Arduino.h>
+#include "FixNum.h"
+#include "Config.h"
+#include "ReportLog.h"
+#include "xprint.h"
+#include "parse.h"
+#include "parse_ref.h"
+
+/*
+ * Reference parser for the differential test: parse.cpp as it was before the grammar table,
+ * copied verbatim into namespace ref (only this comment, the include of parse_ref.h, and the
+ * namespace lines are added). Grammar changes made after the table are not applied here, they
+ * are the intentional divergences listed in parse_diff.cpp.
+ */
+
+namespace ref {
+
+const byte PARSE_ANY    = 0;
+const byte PARSE_ATTN   = 1;      // Attention char '!' received, wait for 'C'
+const byte PARSE_CMD    = 2;      // '!C' was read, wait for command char
+const byte PARSE_TVAL   = 3;      // '!CT'<arg><type> was read, wait for temp value
+const byte PARSE_X_ARG  = 4;      // '[' was read, wait for zone id (in parseArg)
+const byte PARSE_X_VAL0 = 5;      // '['<arg>':' was read, wait for temp value (skip spaces)
+const byte PARSE_X_VAL  = 6;      // .. continues to read value
+const byte PARSE_X_FIN  = 7;      // wait for final ']'
+const byte PARSE_S_ZONE = 8;      // '!CS'<arg>':' was read, wait for zone
+const byte PARSE_A_MIN  = 9;      // '!CAN' was read, wait for arg
+const byte PARSE_A_MAX  = 10;     // '!CAX' was read, wait for arg
+const byte PARSE_N_COUNT = 11;    // '!CN'<arg>':' was read, wait for slot count
+const byte PARSE_FRAME  = 12;     // '!C#' was read, wait for sequence number and ':'
+const byte PARSE_X_SUM  = 13;     // '['<arg>':'<temp>...'#' was read, wait for hex checksum and ']'
+
+const byte PARSE_HOTWATER = 'H';    // '!CH' was read, wait for arg
+const byte PARSE_FORCE    = 'F';    // '!CF' was read, wait for arg
+const byte PARSE_PERIOD   = 'P';    // '!CP' was read, wait for arg
+const byte PARSE_DURATION = 'D';    // '!CD' was read, wait for arg
+const byte PARSE_TEMP     = 'T';    // '!CT' was read, wait for arg
+const byte PARSE_SENSOR   = 'S';    // '!CS' was read, wait for arg
+const byte PARSE_CORRIDOR = 'E';    // '!CE' was read, wait for arg
+const byte PARSE_BACKFILL = 'B';    // '!CB' was read, wait for sequence number
+const byte PARSE_ADAPTIVE = 'A';    // '!CA' was read, wait for parameter type
+const byte PARSE_NODE     = 'N';    // '!CN' was read, wait for arg
+
+const byte TEMP_TYPE_A     = 'A';
+const byte TEMP_TYPE_B     = 'B';
+const byte TEMP_TYPE_P     = 'P';
+const byte TEMP_TYPE_R     = 'R';    // '!CAR'<temp> for adaptive reporting temperature change
+
+const byte ADAPTIVE_MIN    = 'N';
+const byte ADAPTIVE_MAX    = 'X';
+
+byte parseState = PARSE_ANY;
+byte parseArg;
+byte parseTempType;
+byte parseSlot;
+unsigned int parseSeq;
+
+const byte MAX_RECENT_FRAMES = 8;
+
+boolean parseFramed; // true when parsing framed command
+unsigned int frameSeq;
+unsigned int recentFrames[MAX_RECENT_FRAMES];
+byte recentFramesHead;
+byte recentFramesSize;
+
+typedef FixNumParser<int> temp_parser_t;
+temp_parser_t parseTempVal;
+
+const byte MAX_BATCH = 8;
+
+byte parseSum; // sum of chars after '[' for checksum
+byte batchSize;
+byte batchZone[MAX_BATCH];
+TempZones::temp_t batchTemp[MAX_BATCH];
+
+void applyBatch() {
+  for (byte i = 0; i < batchSize; i++)
+    tempZones.setReceived(batchZone[i], batchTemp[i]);
+  batchSize = 0;
+  parseState = PARSE_ANY;
+}
+
+char parseChar(char ch) {
+  boolean eoln = ch == '\r' || ch == '\n';
+  if (parseState >= PARSE_X_ARG && parseState <= PARSE_X_FIN && ch != '#')
+    parseSum += ch;
+  switch (parseState) {
+    case PARSE_X_VAL0:
+      if (ch == ' ') 
+        break; // skip spaces
+      parseState = PARSE_X_VAL;  
+      // fall through to read number
+    case PARSE_X_VAL:
+      { // block to encapsulate result var
+        temp_parser_t::Result result = parseTempVal.parse(ch);
+        if (result == temp_parser_t::NUM)
+          break; // continue parsing number
+        if (result == temp_parser_t::BAD) {
+          parseState = PARSE_ANY;
+          break;
+        }
+        parseState = PARSE_X_FIN;
+      }
+      // !!! fall through to parse this char in PARSE_X_FIN state
+    case PARSE_X_FIN:
+      if (ch == ']' || ch == ',' || ch == '#') {
+        // zone temperature is over
+        if (batchSize >= MAX_BATCH) {
+          parseState = PARSE_ANY; // too many zones in a packet
+          break;
+        }
+        batchZone[batchSize] = parseArg;
+        batchTemp[batchSize] = parseTempVal;
+        batchSize++;
+        if (ch == ',') {
+          parseState = PARSE_X_ARG;
+          parseArg = 0;
+        } else if (ch == '#') {
+          parseState = PARSE_X_SUM;
+          parseSeq = 0;
+        } else
+          applyBatch();
+        break;
+      }
+      if (ch != '[' && ch != '!' && !eoln)
+        break; // wait for more chars
+      parseState = PARSE_ANY;  
+      if (eoln)
+        break; // line over w/o closing brace!
+      // !!! fall through to parse any -- some other packet begin while old one is not over yet
+    case PARSE_ANY:
+      switch (ch) {
+        case '!':
+          parseState = PARSE_ATTN;
+          break;
+        case '[':
+          parseState = PARSE_X_ARG;
+          parseArg = 0;
+          parseSum = 0;
+          batchSize = 0;
+          break;     
+      }
+      break;
+    case PARSE_ATTN:
+      parseState = (ch == 'C') ? PARSE_CMD : PARSE_ANY;
+      break;
+    case PARSE_CMD:
+      switch (ch) {
+        case CMD_DUMP_STATE: 
+        case CMD_DUMP_CONFIG:
+        case CMD_DUMP_ZONES:
+        case CMD_DUMP_INFO:
+        case CMD_DUMP_TRENDS:
+        case CMD_DUMP_USAGE:
+        case CMD_DUMP_RECORDER:
+        case CMD_BEACON:
+        case '1': 
+        case '2': 
+        case '3': 
+        case '4':
+          parseState = PARSE_ANY;
+          return ch; // command for external processing
+        case PARSE_HOTWATER:
+        case PARSE_FORCE:
+        case PARSE_PERIOD:
+        case PARSE_DURATION:
+        case PARSE_CORRIDOR:
+        case PARSE_TEMP:
+        case PARSE_SENSOR:
+        case PARSE_NODE:
+          parseState = ch;
+          parseArg = 0;
+          break;
+        case PARSE_BACKFILL:
+          parseState = ch;
+          parseSeq = 0;
+          break;
+        case PARSE_ADAPTIVE:
+          parseState = ch;
+          break;
+        case '#':
+          if (!parseFramed) {
+            parseState = PARSE_FRAME;
+            frameSeq = 0;
+            break;
+          }
+          // falls through -- no nested frames
+        default:
+          parseState = PARSE_ANY;
+      }
+      break;
+    case PARSE_TEMP:
+      switch (ch) {
+        case TEMP_TYPE_A: 
+        case TEMP_TYPE_B: 
+        case TEMP_TYPE_P:
+          if (parseArg >= TempZones::N_ZONES) {
+            parseState = PARSE_ANY;
+          } else {
+            parseTempType = ch;
+            parseState = PARSE_TVAL;
+            parseTempVal.reset();
+          }
+          return 0;        
+      }
+      // falls through to parse arg
+    case PARSE_SENSOR:
+      if (parseState == PARSE_SENSOR && ch == ':' && parseArg < DS18B20::MAX_SENSORS) {
+        parseSlot = parseArg;
+        parseArg = 0;
+        parseState = PARSE_S_ZONE;
+        break;
+      }
+      // falls through to parse arg
+    case PARSE_NODE:
+      if (parseState == PARSE_NODE && ch == ':') {
+        parseSlot = parseArg;
+        parseArg = 0;
+        parseState = PARSE_N_COUNT;
+        break;
+      }
+      // falls through to parse arg
+    case PARSE_HOTWATER:
+    case PARSE_FORCE:
+    case PARSE_PERIOD:
+    case PARSE_DURATION:
+    case PARSE_CORRIDOR:
+    case PARSE_A_MIN:
+    case PARSE_A_MAX:
+    case PARSE_N_COUNT:
+    case PARSE_S_ZONE:
+    case PARSE_X_ARG:
+      if (ch >= '0' && ch <= '9') {
+        byte digit = ch - '0';
+        parseArg = parseArg > (255 - 9) / 10 ? 255 : parseArg * 10 + digit; // saturate on overflow
+        break;
+      }
+      if (parseState == PARSE_X_ARG) {
+        if (ch == ':' && parseArg > 0 && parseArg < TempZones::N_ZONES) {
+          parseState = PARSE_X_VAL0;
+          parseTempVal.reset();
+          break;
+        } else {
+          parseState = PARSE_ANY;
+          break;
+        }
+      }
+      // for states other than PARSE_X_xxx
+      if (eoln) {
+        switch (parseState) {
+          case PARSE_HOTWATER:
+            config.hotwater = parseArg;
+            break;
+          case PARSE_FORCE:
+            config.force = (Force::Mode)parseArg;
+            break;
+          case PARSE_PERIOD:
+            config.period = parseArg;
+            break;
+          case PARSE_DURATION:
+            config.duration = parseArg;
+            break;
+          case PARSE_CORRIDOR:
+            config.corridor = parseArg;
+            break;
+          case PARSE_A_MIN:
+            config.reportMin = parseArg;
+            break;
+          case PARSE_A_MAX:
+            config.reportMax = parseArg;
+            break;
+          case PARSE_S_ZONE:
+            config.sensor[parseSlot].zone = parseArg;
+            break;
+          case PARSE_N_COUNT:
+            config.slotNode = parseSlot;
+            config.slotCount = parseArg;
+            break;
+        }
+        parseState = PARSE_ANY;
+        return CMD_CONFIG_CHANGED;
+      }
+      parseState = PARSE_ANY;
+      break;
+    case PARSE_X_SUM:
+      if (ch == ']') {
+        // checksummed packet is over, apply it only when checksum matches
+        if (parseSeq == parseSum)
+          applyBatch();
+        parseState = PARSE_ANY;
+        break;
+      }
+      { // block to encapsulate digit var
+        byte digit;
+        if (ch >= '0' && ch <= '9')
+          digit = ch - '0';
+        else if (ch >= 'A' && ch <= 'F')
+          digit = ch - 'A' + 10;
+        else if (ch >= 'a' && ch <= 'f')
+          digit = ch - 'a' + 10;
+        else {
+          parseState = PARSE_ANY;
+          break;
+        }
+        parseSeq = parseSeq * 16 + digit;
+        if (parseSeq > 0xff)
+          parseState = PARSE_ANY;
+      }
+      break;
+    case PARSE_FRAME:
+      if (ch >= '0' && ch <= '9') {
+        frameSeq = frameSeq * 10 + (ch - '0');
+        break;
+      }
+      if (ch == ':') {
+        parseFramed = true;
+        parseState = PARSE_CMD;
+        break;
+      }
+      parseState = PARSE_ANY;
+      break;
+    case PARSE_ADAPTIVE:
+      parseArg = 0;
+      switch (ch) {
+        case ADAPTIVE_MIN:
+          parseState = PARSE_A_MIN;
+          break;
+        case ADAPTIVE_MAX:
+          parseState = PARSE_A_MAX;
+          break;
+        case TEMP_TYPE_R:
+          parseTempType = ch;
+          parseState = PARSE_TVAL;
+          parseTempVal.reset();
+          break;
+        default:
+          parseState = PARSE_ANY;
+      }
+      break;
+    case PARSE_BACKFILL:
+      if (ch >= '0' && ch <= '9') {
+        parseSeq = parseSeq * 10 + (ch - '0');
+        break;
+      }
+      parseState = PARSE_ANY;
+      if (eoln) {
+        reportLog.request(parseSeq);
+        return CMD_DONE;
+      }
+      break;
+    case PARSE_TVAL:
+      { // block to encapsulate result var
+        temp_parser_t::Result result = parseTempVal.parse(ch);
+        if (result != temp_parser_t::NUM) {
+          if (eoln) {
+            Config::temp_t temp = result == temp_parser_t::BAD ? Config::temp_t::invalid() : parseTempVal;
+            switch (parseTempType) {
+              case TEMP_TYPE_A:
+                config.zone[parseArg].tempA = temp;
+                break;
+              case TEMP_TYPE_B:
+                config.zone[parseArg].tempB = temp;
+                break;
+              case TEMP_TYPE_P:
+                config.zone[parseArg].tempP = temp;
+                break;
+              case TEMP_TYPE_R:
+                config.reportTemp = temp;
+                break;
+            }
+            if (parseTempType != TEMP_TYPE_R)
+              force.zoneChanged(parseArg);
+            parseState = PARSE_ANY;
+            return CMD_CONFIG_CHANGED;
+          } else
+            parseState = PARSE_ANY;
+        }
+      }
+      break;    
+  }
+  return 0;
+}
+
+void ackFrame(char result) {
+  waitPrint();
+  print_C("[C");
+  print(result);
+  print(frameSeq, DEC);
+  print_C("]*\r\n");
+}
+
+// Returns true if frame with this sequence number was recently seen, remembers it otherwise
+boolean checkRecentFrame() {
+  for (byte i = 0; i < recentFramesSize; i++)
+    if (recentFrames[i] == frameSeq)
+      return true;
+  recentFrames[recentFramesHead] = frameSeq;
+  if (++recentFramesHead == MAX_RECENT_FRAMES)
+    recentFramesHead = 0;
+  if (recentFramesSize < MAX_RECENT_FRAMES)
+    recentFramesSize++;
+  return false;
+}
+
+char parseCommand() {
+  while (Serial.available()) {
+    char cmd = parseChar(Serial.read());
+    if (parseFramed && (cmd != 0 || parseState == PARSE_ANY)) {
+      // framed command is over
+      parseFramed = false;
+      if (cmd == 0) {
+        ackFrame('-');
+        continue;
+      }
+      boolean retry = checkRecentFrame();
+      ackFrame('+');
+      if (retry || cmd == CMD_CONFIG_CHANGED)
+        continue; // already executed or does not need config dump
+      return cmd;
+    }
+    if (cmd != 0)
+      return cmd;
+  }
+  return 0;
+}
+
+} // namespace ref
@@ -0,0 +1,29 @@
+#ifndef PARSE_REF_H_
+#define PARSE_REF_H_
+
+#include <Arduino.h>
+#include "host.h"
+#include "TempZones.h"
+#include "Force.h"
+#include "ReportLog.h"
+#include "Capture.h"
+
+// Reference hand-written parser, see parse_ref.cpp
+namespace ref {
+  char parseChar(char ch);
+  char parseCommand();
+}
+
+// Board objects the reference works on (ref_board.cpp), the parser under test is given the same ones
+extern Host::Board board;
+extern TempZones tempZones;
+extern Force force;
+extern ReportLog reportLog;
+
+/** Waits for the serial output of the board, the reference calls it before acks. */
+void waitPrint();
+
+/** Clears config and zones of the board. */
+void resetBoard();
+
+#endif /* PARSE_REF_H_ */
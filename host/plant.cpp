@@ -0,0 +1,110 @@
+#include <math.h>
+#include "plant.h"
+#include "Timeout.h"
+
+const double Plant::WATER_SET = 70;
+const double Plant::WATER_HYST = 10;
+
+const Plant::Params Plant::DEFAULT_PARAMS = {
+  4,     // rooms
+  1.0,   // capacity
+  0.04,  // loss
+  0.05,  // coupling
+  0.06,  // radiator
+  0.05,  // water
+  12,    // burner
+  18,    // start
+  18,    // comfort
+  0.5,   // lockouts
+  MILD
+};
+
+const double RADIATOR_IDLE = 0.1; // part of radiator conductance without circulation
+
+Plant::Plant(Host::Board& board, const Params& params, unsigned long seed) :
+  stats(),
+  _board(board),
+  _params(params),
+  _water(params.start),
+  _burning(false),
+  _lockout(false),
+  _seed(seed)
+{
+  if (_params.rooms > MAX_ROOMS)
+    _params.rooms = MAX_ROOMS;
+  for (byte i = 0; i < _params.rooms; i++)
+    _room[i] = params.start;
+}
+
+double Plant::random() {
+  _seed = _seed * 1103515245 + 12345;
+  return ((_seed >> 8) & 0xffffff) / (double)0x1000000;
+}
+
+double Plant::outside() {
+  double days = _board.time() / (double)Timeout::DAY;
+  double hour = fmod(days, 1) * 24;
+  double daily = -cos((hour - 5) * M_PI / 12); // coldest at 5:00, warmest at 17:00
+  switch (_params.outside) {
+  case COLD:
+    return -12 + 5 * daily;
+  case FRONT:
+    if (days >= 1)
+      return 5 - 40 * fmin(days - 1, 0.5) + 4 * daily;
+    // fall through
+  default:
+    return 5 + 4 * daily;
+  }
+}
+
+void Plant::step(unsigned long ms) {
+  double hours = ms / (double)Timeout::HOUR;
+  byte hour = _board.time() / Timeout::HOUR % 24;
+  _board.turnedOn = _board.panelMode == State::MODE_WORKING ||
+    (_board.panelMode == State::MODE_TIMER && hour >= TIMER_ON && hour < TIMER_OFF);
+  boolean on = _board.turnedOn || _board.forceOn;
+
+  // heater thermostat and lockouts
+  if (on && !_lockout && random() < _params.lockouts * hours / 24)
+    _lockout = true;
+  boolean burning = on && !_lockout && (_water < WATER_SET - WATER_HYST || (_burning && _water < WATER_SET));
+  if (burning && !_burning)
+    stats.burnerStarts++;
+  _burning = burning;
+  if (burning)
+    stats.burnerHours += hours;
+  if (on && _lockout)
+    stats.lockoutMinutes += hours * 60;
+
+  // heat flows (kW)
+  double out = outside();
+  double radiator = _params.radiator * (on ? 1 : RADIATOR_IDLE);
+  double flow[MAX_ROOMS];
+  double waterFlow = burning ? _params.burner : 0;
+  for (byte i = 0; i < _params.rooms; i++) {
+    double loss = _params.loss * (1 + i / (double)max(_params.rooms - 1, 1));
+    double heat = radiator * (_water - _room[i]);
+    flow[i] = heat - loss * (_room[i] - out);
+    if (i > 0)
+      flow[i] += _params.coupling * (_room[i - 1] - _room[i]);
+    if (i + 1 < _params.rooms)
+      flow[i] += _params.coupling * (_room[i + 1] - _room[i]);
+    waterFlow -= heat;
+  }
+  for (byte i = 0; i < _params.rooms; i++) {
+    _room[i] += flow[i] * hours / _params.capacity;
+    if (_room[i] < _params.comfort)
+      stats.comfortMinutes += hours * 60;
+  }
+  _water += waterFlow * hours / _params.water;
+
+  // panel
+  _board.scan = (_board.panelMode != State::MODE_UNKNOWN ? 1 << (_board.panelMode - 1) : 0) | (burning << State::ACTIVE_LED);
+}
+
+void Plant::reset() {
+  stats.resets++;
+  if (!_lockout)
+    stats.falseResets++;
+  _lockout = false;
+}
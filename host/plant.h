@@ -0,0 +1,91 @@
+#ifndef PLANT_H_
+#define PLANT_H_
+
+#include <Arduino.h>
+#include "host.h"
+
+/**
+ * Thermal model of the house and the heater for the host build. Rooms are an RC network: each room
+ * has heat capacity, loses heat to the outside, exchanges it with its neighbours, and gets it from
+ * the radiators while the heater circulates water. The heater is on in WORKING mode, during the
+ * day in TIMER mode, and when forced on; its own thermostat then fires the burner to keep water
+ * between WATER_SET - WATER_HYST and WATER_SET. The burner may lock out silently at random times,
+ * then only the reset signal ("!RR") brings it back.
+ *
+ * The plant drives the board of its node: panel LEDs of the mode and of the burner, and the heater
+ * turning on by itself. Room 0 is where the controller and its local sensor are.
+ */
+class Plant {
+public:
+  static const byte MAX_ROOMS = 16;
+  static const double WATER_SET;  // deg C
+  static const double WATER_HYST; // deg C
+  static const byte TIMER_ON = 6;   // hour of day when TIMER mode turns heater on
+  static const byte TIMER_OFF = 22; // hour of day when TIMER mode turns heater off
+
+  enum Outside {
+    MILD,  // 5 deg C on average, 8 deg C swing over the day
+    COLD,  // -12 deg C on average, 10 deg C swing over the day
+    FRONT  // mild for the first day, then drops to -15 deg C within 12 hours
+  };
+
+  struct Params {
+    byte    rooms;
+    double  capacity;      // heat capacity of a room (kWh/K)
+    double  loss;          // conductance of the first room to the outside (kW/K), the last one loses twice that
+    double  coupling;      // conductance between neighbouring rooms (kW/K)
+    double  radiator;      // conductance of radiators of a room while water circulates (kW/K)
+    double  water;         // heat capacity of water in the system (kWh/K)
+    double  burner;        // burner power (kW)
+    double  start;         // initial temperature of rooms and water (deg C)
+    double  comfort;       // room temperature below which minutes count as comfort violation (deg C)
+    double  lockouts;      // expected burner lockouts per day of burning
+    Outside outside;
+  };
+
+  static const Params DEFAULT_PARAMS;
+
+  struct Stats {
+    double        comfortMinutes; // sum over rooms of minutes below comfort
+    unsigned long burnerStarts;
+    double        burnerHours;
+    double        lockoutMinutes; // minutes heater was on, but locked out
+    unsigned int  resets;         // reset signals
+    unsigned int  falseResets;    // reset signals without lockout
+  };
+
+  Stats stats;
+
+  Plant(Host::Board& board, const Params& params, unsigned long seed);
+
+  /** Moves plant by ms following the heater mode and force in the board. */
+  void step(unsigned long ms);
+
+  /** Reset signal of the controller, clears lockout. */
+  void reset();
+
+  double room(byte i);
+  double water();
+  double outside();
+
+private:
+  Host::Board&  _board;
+  Params        _params;
+  double        _room[MAX_ROOMS];
+  double        _water;
+  boolean       _burning;
+  boolean       _lockout;
+  unsigned long _seed;
+
+  double random(); // uniformly in [0, 1)
+};
+
+inline double Plant::room(byte i) {
+  return _room[i];
+}
+
+inline double Plant::water() {
+  return _water;
+}
+
+#endif /* PLANT_H_ */
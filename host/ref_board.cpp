@@ -0,0 +1,24 @@
+#include <new>
+#include "parse_ref.h"
+#include "Config.h"
+
+/*
+ * The board of the reference parser: its firmware modules were singletons, so they are defined here
+ * around the config in EEPROM (Config.cpp) and the Serial of the Arduino core.
+ */
+
+Host::Board board;
+Force force(board, config, tempZones);
+TempZones tempZones(board, force);
+ReportLog reportLog(board, Serial);
+Capture capture(board);
+
+void waitPrint() {
+  board.waitPrint();
+}
+
+void resetBoard() {
+  memset((void*)&config, 0, sizeof(Config));
+  tempZones.~TempZones();
+  new (&tempZones) TempZones(board, force);
+}
@@ -0,0 +1,549 @@
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "node.h"
+#include "Config.h"
+#include "Capture.h"
+
+/*
+ * Replays a recorded serial trace of one controller through the host build and compares its
+ * decisions with the recording. The trace is what the gateway saw on the serial link, line by line:
+ * dump lines of the controller, its "!RR" reset signals, and the commands and zone packets it got.
+ *
+ * Inputs are reconstructed from the trace:
+ *   - time is the uptime of dump lines, other lines are spread evenly between the dumps around them;
+ *   - config is taken from the first config dump ([CC ...]), so keep one at the top of the trace;
+ *   - the local temperature, panel LEDs, error, presets, and the heater turning on by itself in
+ *     WORKING, TIMER, or HOTWATER mode are taken from each dump line at its time;
+ *   - the mode is taken from the first dump and from dumps of external changes ('b', '0', '1'),
+ *     a restore dump ('r') means the panel was switched to WORKING;
+ *   - commands ("!C...") and zone packets ("[<zone>:...") are fed to the parser.
+ *
+ * With -x the inputs of the last capture dump in the trace ([CX ...]*, see Capture.h) replace the
+ * reconstructed ones over the time they cover: the parser gets the exact serial bytes, and the panel
+ * state, sensor reads, and analog inputs change when they did. The trace before that is replayed as
+ * above to bring the firmware state there. The replay stops TOLERANCE after the last captured input
+ * and checks that the capture of the replay is frozen for the same reason at the same time.
+ *
+ * Decisions are dumps of types f, r, h, c, b, e, n, 0, 1 and reset signals (R). A decision matches
+ * when the replay makes the same one within TOLERANCE. Each trace runs on a fresh node. Prints matched, missing and extra decisions, and simulated days per second.
+ * Exits with 1 when any decision does not match.
+ *
+ * Usage: replay [-x] <trace>...
+ */
+
+const unsigned long LOOP_INTERVAL = 1000; // firmware loop runs every second of virtual time
+const unsigned long TOLERANCE = 2 * Timeout::MINUTE;
+const unsigned long RUN_OUT = 10 * Timeout::MINUTE; // time to run after the last line
+const char DECISIONS[] = "frhcben01R";
+const byte MAX_REPORTED = 10; // mismatches printed per trace
+
+struct Dump {
+  byte          mode;
+  Sensor::temp_t temp;
+  byte          state;
+  int           presetTemp;
+  int           presetTime;
+  unsigned long uptime; // ms
+  char          type;   // 0 for regular dump
+};
+
+struct Line {
+  unsigned long time;
+  std::string   text;
+  boolean       isDump;
+  Dump          dump;
+};
+
+struct Record {
+  unsigned long time;
+  byte          kind;
+  std::string   payload;
+};
+
+// Error LED of captured panel state, it blinks on the board, so error holds ERROR_HOLD after it was on
+struct ErrorLed {
+  boolean       on;
+  unsigned long time;
+};
+
+const unsigned long ERROR_HOLD = 2 * Timeout::SECOND;
+
+struct CaptureDump {
+  char                reason; // '-' when not frozen
+  unsigned long       time;   // of the last record, in the time of the trace
+  std::vector<Record> records;
+};
+
+// Returns value after marker that is searched from pos on, pos is moved after the value
+double field(const std::string& s, const char* marker, size_t& pos, boolean& ok) {
+  size_t i = s.find(marker, pos);
+  if (i == std::string::npos) {
+    ok = false;
+    return 0;
+  }
+  const char* start = s.c_str() + i + strlen(marker);
+  char* end;
+  double x = strtod(start, &end);
+  if (end == start)
+    ok = false;
+  pos = end - s.c_str();
+  return x;
+}
+
+// Parses "[C:<mode> +<temp> e<error>o<active>z<zone>;s<state bits> ... u<days><hhmmss>[#<seq>]]<type>*"
+boolean parseDump(const std::string& s, Dump& d) {
+  if (s.compare(0, 3, "[C:") != 0 || s.size() < 5 || s[3] < '0' || s[3] > '0' + MAX_MODE)
+    return false;
+  d.mode = s[3] - '0';
+  boolean ok = true;
+  size_t pos = 4;
+  double temp = field(s, " ", pos, ok);
+  d.temp = ok ? Sensor::temp_t((int)lround(temp * 100)) : Sensor::temp_t::invalid();
+  ok = true;
+  size_t bits = s.find(";s", pos);
+  if (bits == std::string::npos || bits + 2 + STATE_SIZE > s.size())
+    return false;
+  d.state = 0;
+  for (byte i = 0; i < STATE_SIZE; i++)
+    if (s[bits + 2 + i] == '1')
+      d.state |= 1 << i;
+  pos = bits + 2 + STATE_SIZE;
+  d.presetTemp = lround(field(s, "p", pos, ok) * 10);
+  d.presetTime = lround(field(s, "q", pos, ok) * 10);
+  size_t u = s.find('u', pos);
+  size_t seq = s.find_first_of("#]", u + 1); // sequence number is optional
+  if (!ok || u == std::string::npos || seq == std::string::npos || seq < u + 7)
+    return false;
+  std::string up = s.substr(u + 1, seq - u - 1);
+  unsigned long hms = strtoul(up.substr(up.size() - 6).c_str(), 0, 10);
+  d.uptime = (strtoul(up.substr(0, up.size() - 6).c_str(), 0, 10) * 86400UL +
+    hms / 10000 * 3600 + hms / 100 % 100 * 60 + hms % 100) * Timeout::SECOND;
+  size_t end = s.find(']', seq);
+  if (end == std::string::npos)
+    return false;
+  d.type = end + 1 < s.size() ? s[end + 1] : 0;
+  return true;
+}
+
+// Writes config fields from config dump "[CC M% H% F% P% D% E% [Q1] [N%:%] [A{N% X% R%}] [T%{A% B% P%}]..."
+void applyConfigDump(Config& config, const std::string& s) {
+  memset((void*)&config, 0xff, sizeof(Config)); // unprogrammed EEPROM
+  size_t pos = 3;
+  boolean ok = true;
+  config.mode = (State::Mode)field(s, " M", pos, ok);
+  config.hotwater = (byte)field(s, " H", pos, ok);
+  config.force = (Force::Mode)field(s, " F", pos, ok);
+  config.period = (byte)field(s, " P", pos, ok);
+  config.duration = (byte)field(s, " D", pos, ok);
+  config.corridor = (byte)field(s, " E", pos, ok);
+  if (s.find(" Q1", pos) != std::string::npos)
+    config.reportSeq = 1;
+  size_t i = s.find(" N", pos);
+  if (i != std::string::npos) {
+    pos = i;
+    config.slotNode = (byte)field(s, " N", pos, ok);
+    config.slotCount = (byte)field(s, ":", pos, ok);
+  }
+  i = s.find(" A{", pos);
+  if (i != std::string::npos) {
+    pos = i;
+    config.reportMin = (byte)field(s, "N", pos, ok);
+    config.reportMax = (byte)field(s, "X", pos, ok);
+    config.reportTemp = Config::temp_t((byte)lround(field(s, "R", pos, ok) * 10));
+  }
+  while ((i = s.find(" T", pos)) != std::string::npos) {
+    pos = i;
+    byte zone = (byte)field(s, " T", pos, ok);
+    size_t end = s.find('}', pos);
+    if (zone >= TempZones::N_ZONES || end == std::string::npos)
+      break;
+    std::string temps = s.substr(pos, end - pos);
+    Config::Zone& z = config.zone[zone];
+    size_t p = 0;
+    boolean found = true;
+    double t = field(temps, "A", p, found);
+    if (found)
+      z.tempA = Config::temp_t((byte)lround(t * 10));
+    p = 0;
+    found = true;
+    t = field(temps, "B", p, found);
+    if (found)
+      z.tempB = Config::temp_t((byte)lround(t * 10));
+    p = 0;
+    found = true;
+    t = field(temps, "P", p, found);
+    if (found)
+      z.tempP = Config::temp_t((byte)lround(t * 10));
+    pos = end;
+  }
+}
+
+// Decodes binary records of capture dump, times are relative to the last one
+boolean parseRecords(const std::string& data, std::vector<Record>& records) {
+  records.clear();
+  size_t pos = 0;
+  unsigned long time = 0;
+  while (pos < data.size()) {
+    Record r;
+    r.kind = data[pos++];
+    unsigned long dt = 0;
+    byte shift = 0;
+    byte b;
+    do {
+      if (pos == data.size())
+        return false;
+      b = data[pos++];
+      dt |= (unsigned long)(b & 0x7f) << shift;
+      shift += 7;
+    } while (b & 0x80);
+    byte size = Capture::payloadSize(r.kind);
+    if (pos + size > data.size())
+      return false;
+    r.payload = data.substr(pos, size);
+    pos += size;
+    time = records.empty() ? 0 : time + dt; // the first one follows a dropped record
+    r.time = time;
+    records.push_back(r);
+  }
+  for (size_t i = 0; i < records.size(); i++)
+    records[i].time -= time;
+  return true;
+}
+
+// Cuts binary records of capture dumps "[CX <reason> T<time> L<size>:<records>]*" out of text,
+// so each one stays a line, and keeps the last one
+boolean cutCaptures(std::string& text, CaptureDump& capture, size_t& line) {
+  std::string out;
+  size_t pos = 0;
+  size_t i;
+  while ((i = text.find("[CX ", pos)) != std::string::npos) {
+    size_t colon = text.find(':', i);
+    size_t t = text.find(" T", i);
+    size_t l = text.find(" L", i);
+    if (colon == std::string::npos || t > colon || l > colon)
+      return false;
+    size_t size = strtoul(text.c_str() + l + 2, 0, 10);
+    if (colon + 1 + size > text.size())
+      return false;
+    capture.reason = text[i + 4];
+    capture.time = strtoul(text.c_str() + t + 2, 0, 10);
+    if (!parseRecords(text.substr(colon + 1, size), capture.records))
+      return false;
+    out.append(text, pos, colon + 1 - pos);
+    line = std::count(out.begin(), out.end(), '\n');
+    pos = colon + 1 + size;
+  }
+  out.append(text, pos, std::string::npos);
+  text.swap(out);
+  return true;
+}
+
+// Reads trace and assigns time to each line
+boolean readTrace(const char* name, std::vector<Line>& lines, std::string& configDump, int& restarts,
+    CaptureDump& capture) {
+  std::ifstream file(name, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "%s: cannot open\n", name);
+    return false;
+  }
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  size_t captureLine = std::string::npos;
+  if (!cutCaptures(data, capture, captureLine)) {
+    fprintf(stderr, "%s: broken capture dump\n", name);
+    return false;
+  }
+  std::istringstream in(data);
+  std::string text;
+  unsigned long offset = 0;
+  unsigned long last = 0;
+  while (std::getline(in, text)) {
+    if (lines.size() == captureLine)
+      capture.time += offset; // captured in the time since the last restart
+    if (!text.empty() && text[text.size() - 1] == '\r')
+      text.erase(text.size() - 1);
+    Line line;
+    line.text = text;
+    line.isDump = parseDump(text, line.dump);
+    if (line.isDump) {
+      if (line.dump.uptime + offset + TOLERANCE < last) {
+        offset = last - line.dump.uptime; // restarted, keep time going
+        restarts++;
+      }
+      line.time = last = max(line.dump.uptime + offset, last);
+    } else if (text.compare(0, 3, "[CC") == 0 && configDump.empty())
+      configDump = text;
+    lines.push_back(line);
+  }
+  // spread other lines between dumps around them
+  size_t prev = lines.size();
+  for (size_t i = 0; i <= lines.size(); i++) {
+    if (i < lines.size() && !lines[i].isDump)
+      continue;
+    size_t first = prev == lines.size() ? 0 : prev + 1;
+    unsigned long from = prev == lines.size() ? (i < lines.size() ? lines[i].time : 0) : lines[prev].time;
+    unsigned long to = i < lines.size() ? lines[i].time : from;
+    for (size_t k = first; k < i; k++)
+      lines[k].time = from + (to - from) * (k - first + 1) / (i - first + 1);
+    prev = i;
+  }
+  return true;
+}
+
+struct Decision {
+  unsigned long time;
+  char          kind;
+};
+
+// Serial output of the replayed node, collects its decisions
+class Decisions : public Print {
+public:
+  std::vector<Decision> list;
+
+  Decisions(Host::Board& board) : _board(board) {}
+
+  virtual size_t write(uint8_t c) {
+    if (c != '\n') {
+      _line += (char)c;
+      return 1;
+    }
+    if (!_line.empty() && _line[_line.size() - 1] == '\r')
+      _line.erase(_line.size() - 1);
+    Dump d;
+    if (_line == "!RR")
+      add(_board.time(), 'R');
+    else if (parseDump(_line, d))
+      add(_board.time(), d.type);
+    _line.clear();
+    return 1;
+  }
+
+  void add(unsigned long time, char kind) {
+    if (kind != 0 && strchr(DECISIONS, kind)) {
+      Decision d = { time, kind };
+      list.push_back(d);
+    }
+  }
+
+private:
+  Host::Board& _board;
+  std::string  _line;
+};
+
+void applyDump(Node& node, const Dump& d, boolean first) {
+  Host::Board& board = node.board;
+  if (first || d.type == 'b' || d.type == '0' || d.type == '1')
+    board.setMode((State::Mode)d.mode);
+  else if (d.type == 'r')
+    board.setMode(State::MODE_WORKING);
+  board.scan = d.state & (((1 << State::ERROR_LED) - 1) | (1 << State::ACTIVE_LED));
+  board.error = (d.state >> State::ERROR_LED) & 1;
+  board.turnedOn = ((d.state >> State::ACTIVE_SIGNAL) & 1) &&
+    (d.mode == State::MODE_WORKING || d.mode == State::MODE_TIMER || d.mode == State::MODE_HOTWATER);
+  board.tempKnob = d.presetTemp;
+  board.timeKnob = d.presetTime;
+  node.sensor.set(d.temp);
+}
+
+// Sets input of captured record
+void applyRecord(Node& node, const Record& r, ErrorLed& led) {
+  Host::Board& board = node.board;
+  const byte* p = (const byte*)r.payload.data();
+  int value = r.payload.size() == 2 ? (int)(short)(p[0] | (p[1] << 8)) : p[0];
+  switch (r.kind & Capture::KIND_MASK) {
+  case Capture::SERIAL:
+    node.input(r.payload.c_str());
+    break;
+  case Capture::STATE:
+    for (byte i = 0; i < MAX_MODE; i++)
+      if ((value & MODE_MASK) == (1 << i))
+        board.setMode((State::Mode)(i + 1));
+    board.scan = value & ~(1 << State::ERROR_LED);
+    led.on = (value >> State::ERROR_LED) & 1;
+    led.time = r.time;
+    if (led.on)
+      board.error = true;
+    break;
+  case Capture::TEMP:
+    if ((r.kind & ~Capture::KIND_MASK) == 0)
+      node.sensor.set(value == Capture::NO_TEMP ? Sensor::temp_t::invalid() : Sensor::temp_t(value * 100 / 16));
+    break;
+  case Capture::ANALOG:
+    switch (r.kind & ~Capture::KIND_MASK) {
+    case Capture::ANALOG_PRESET_TEMP:
+      board.tempKnob = value;
+      break;
+    case Capture::ANALOG_PRESET_TIME:
+      board.timeKnob = value;
+      break;
+    case Capture::ANALOG_TURNED_ON:
+      board.turnedOn = value != 0;
+      break;
+    }
+    break;
+  }
+}
+
+std::string timeText(unsigned long ms) {
+  char buf[32];
+  unsigned long s = ms / Timeout::SECOND;
+  snprintf(buf, sizeof(buf), "%lud %02lu:%02lu:%02lu", s / 86400, s / 3600 % 24, s / 60 % 60, s % 60);
+  return buf;
+}
+
+// Matches decisions of each kind in time order, returns number of mismatches
+int compare(const std::vector<Decision>& recorded, const std::vector<Decision>& replayed, int& matched) {
+  int mismatches = 0;
+  for (const char* kind = DECISIONS; *kind; kind++) {
+    std::vector<unsigned long> r, p;
+    for (size_t i = 0; i < recorded.size(); i++)
+      if (recorded[i].kind == *kind)
+        r.push_back(recorded[i].time);
+    for (size_t i = 0; i < replayed.size(); i++)
+      if (replayed[i].kind == *kind)
+        p.push_back(replayed[i].time);
+    size_t i = 0, j = 0;
+    while (i < r.size() || j < p.size()) {
+      const char* what;
+      unsigned long time;
+      if (i < r.size() && j < p.size() && (r[i] > p[j] ? r[i] - p[j] : p[j] - r[i]) <= TOLERANCE) {
+        matched++;
+        i++;
+        j++;
+        continue;
+      }
+      if (j == p.size() || (i < r.size() && r[i] < p[j])) {
+        what = "missing";
+        time = r[i++];
+      } else {
+        what = "extra  ";
+        time = p[j++];
+      }
+      if (mismatches++ < MAX_REPORTED)
+        printf("  %s %c at %s\n", what, *kind, timeText(time).c_str());
+    }
+  }
+  return mismatches;
+}
+
+int replay(const char* name, boolean captured) {
+  std::vector<Line> lines;
+  std::string configDump;
+  int restarts = 0;
+  CaptureDump capt;
+  if (!readTrace(name, lines, configDump, restarts, capt))
+    return 1;
+  if (lines.empty()) {
+    printf("%s: empty\n", name);
+    return 0;
+  }
+  if (captured && capt.records.empty()) {
+    printf("%s: no capture dump\n", name);
+    return 1;
+  }
+  // with capture, lines are replayed up to its first record, and decisions are compared up to the end
+  unsigned long captureStart = captured ? capt.time + capt.records[0].time : ULONG_MAX;
+  unsigned long captureEnd = captured ? capt.time + TOLERANCE : ULONG_MAX;
+  std::vector<Decision> recorded;
+  size_t dumps = 0;
+  for (size_t i = 0; i < lines.size() && lines[i].time <= captureEnd; i++) {
+    Decision d = { lines[i].time, 0 };
+    if (lines[i].isDump) {
+      dumps++;
+      d.kind = lines[i].dump.type;
+    } else if (lines[i].text == "!RR")
+      d.kind = 'R';
+    if (d.kind != 0 && strchr(DECISIONS, d.kind))
+      recorded.push_back(d);
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Node node;
+  if (configDump.empty())
+    printf("%s: no config dump, EEPROM is unprogrammed\n", name);
+  else
+    applyConfigDump(node.config, configDump);
+  Decisions out(node.board);
+  node.output(&out);
+  node.board.advance(lines[0].time);
+  boolean first = true;
+  for (size_t i = 0; i < lines.size() && lines[i].time < captureStart; i++) {
+    Line& line = lines[i];
+    while (node.board.time() + LOOP_INTERVAL <= line.time) {
+      node.loop();
+      node.board.advance(LOOP_INTERVAL);
+    }
+    if (line.isDump) {
+      applyDump(node, line.dump, first);
+      first = false;
+    } else if (line.text.compare(0, 2, "!C") == 0 || (line.text.size() > 1 && line.text[0] == '[' &&
+        line.text[1] >= '0' && line.text[1] <= '9')) {
+      node.input((line.text + "\r\n").c_str());
+    }
+  }
+  unsigned long end = node.board.time() + RUN_OUT;
+  if (captured) {
+    ErrorLed led = { node.board.error, node.board.time() };
+    for (size_t i = 0; i < capt.records.size(); i++) {
+      Record r = capt.records[i];
+      r.time += capt.time;
+      while (node.board.time() + LOOP_INTERVAL <= r.time) {
+        if (!led.on && node.board.time() - led.time >= ERROR_HOLD)
+          node.board.error = false;
+        node.loop();
+        node.board.advance(LOOP_INTERVAL);
+      }
+      applyRecord(node, r, led);
+    }
+    end = captureEnd;
+  }
+  while (node.board.time() < end) {
+    node.loop();
+    node.board.advance(LOOP_INTERVAL);
+  }
+  node.output(0);
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  int matched = 0;
+  double days = (min(lines.back().time, end) - lines[0].time) / (double)Timeout::DAY;
+  printf("%s: %.1f days in %.2f s (%.0f days/s), %zu dumps, %d restarts\n", name, days, time.count(),
+    days / time.count(), dumps, restarts);
+  int mismatches = compare(recorded, out.list, matched);
+  printf("  %zu decisions: %d matched, %d mismatched\n", recorded.size(), matched, mismatches);
+  if (captured) {
+    // the replay froze its own capture for the same reason, or it is armed like the dumped one
+    char reason = capt.reason == '-' ? 0 : capt.reason;
+    Capture& capture = node.capture();
+    boolean same = capture.reason() == reason && (reason == 0 ||
+      (capture.time() > capt.time ? capture.time() - capt.time : capt.time - capture.time()) <= TOLERANCE);
+    printf("  %zu captured inputs from %s: %s %c at %s\n", capt.records.size(), timeText(captureStart).c_str(),
+      same ? "reproduced" : "not reproduced", capt.reason, timeText(capt.time).c_str());
+    if (!same)
+      mismatches++;
+  }
+  return mismatches != 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  boolean captured = argc > 1 && strcmp(argv[1], "-x") == 0;
+  int first = captured ? 2 : 1;
+  if (argc <= first) {
+    fprintf(stderr, "Usage: replay [-x] <trace>...\n");
+    return 1;
+  }
+  int result = 0;
+  for (int i = first; i < argc; i++)
+    if (replay(argv[i], captured) != 0)
+      result = 1;
+  return result;
+}
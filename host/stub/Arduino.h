@@ -0,0 +1,102 @@
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+/*
+ * Subset of the Arduino core for the host build. Time is virtual (see host.h) and the serial port
+ * reads from and writes to buffers of the host driver.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <type_traits>
+#include <limits.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define DEC 10
+#define HEX 16
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+#define LOW          0x0
+#define HIGH         0x1
+#define CHANGE       1
+#define FALLING      2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+
+// Functions instead of macros of the core, so that they do not break the standard library
+template<typename T, typename U> inline typename std::common_type<T, U>::type min(T a, U b) { return a < b ? a : b; }
+template<typename T, typename U> inline typename std::common_type<T, U>::type max(T a, U b) { return a > b ? a : b; }
+template<typename T, typename U, typename V> inline T constrain(T x, U a, V b) { return x < a ? a : x > b ? b : x; }
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+// ATmega328 memory sizes for Profile
+#define RAMSTART 0x100
+#define RAMEND   0x8FF
+#define E2END    0x3FF
+
+extern volatile uint8_t SREG;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+int analogRead(uint8_t pin);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void pinMode(uint8_t pin, uint8_t mode);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+void randomSeed(unsigned long seed);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+class Print {
+public:
+  virtual size_t write(uint8_t c) = 0;
+  size_t write(const char* s);
+  virtual size_t write(const uint8_t* buf, size_t size);
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(unsigned char x, int base = DEC);
+  size_t print(int x, int base = DEC);
+  size_t print(unsigned int x, int base = DEC);
+  size_t print(long x, int base = DEC);
+  size_t print(unsigned long x, int base = DEC);
+  size_t println(const char* s);
+  size_t println();
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud);
+  virtual int available();
+  virtual int read();
+  virtual int peek();
+  virtual size_t write(uint8_t c);
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif /* ARDUINO_H_ */
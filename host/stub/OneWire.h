@@ -0,0 +1,21 @@
+#ifndef ONEWIRE_H_
+#define ONEWIRE_H_
+
+// Declarations only, 1-Wire sensors are not linked into the host build
+
+#include <Arduino.h>
+
+class OneWire {
+public:
+  OneWire(uint8_t pin);
+  uint8_t reset();
+  void select(const uint8_t rom[8]);
+  void skip();
+  void write(uint8_t v, uint8_t power = 0);
+  uint8_t read();
+  void reset_search();
+  uint8_t search(uint8_t* rom);
+  static uint8_t crc8(const uint8_t* addr, uint8_t len);
+};
+
+#endif /* ONEWIRE_H_ */
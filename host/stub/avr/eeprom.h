@@ -0,0 +1,13 @@
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+// EEPROM is ordinary memory on the host, config fields are read and written in place
+
+#include <stdint.h>
+
+#define EEMEM
+
+inline uint8_t eeprom_read_byte(const uint8_t* p) { return *p; }
+inline void eeprom_write_byte(uint8_t* p, uint8_t value) { *p = value; }
+
+#endif /* EEPROM_H_ */
@@ -0,0 +1,9 @@
+#ifndef INTERRUPT_H_
+#define INTERRUPT_H_
+
+// There are no interrupts on the host
+
+#define cli()
+#define sei()
+
+#endif /* INTERRUPT_H_ */
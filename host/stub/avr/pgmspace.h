@@ -0,0 +1,16 @@
+#ifndef PGMSPACE_H_
+#define PGMSPACE_H_
+
+// Flash is ordinary memory on the host
+
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_byte_near(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define memcpy_P memcpy
+
+#endif /* PGMSPACE_H_ */
@@ -0,0 +1,268 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "host.h"
+#include "node.h"
+#include "plant.h"
+
+/*
+ * Parameter sweep of the controller against the plant model (plant.h). Every combination of the
+ * listed values runs on a fresh node for the given number of simulated days. Nodes share nothing,
+ * so the runs are spread over threads, up to one per core. Prints a line per combination:
+ * its values, comfort violation (room-minutes below comfort), burner starts, burner duty (%),
+ * minutes of lockout, and reset signals with false ones (sent without lockout).
+ *
+ * Usage: sweep [<name>=<value>[,<value>...] ...]
+ *   swept:   period=0,60,240 duration=10,30 tempA=18 tempB=14,16,18 tempP=18,20 (deg C, all rooms)
+ *            resetMinutes=50 resetDrop=-10 resetAbs=2100 resetWait=180 (see Controller::ResetLimits)
+ *   options: days=7 seed=1 jobs=<cores> rooms=4 lockouts=0.5 outside=mild|cold|front mode=working|timer|off
+ *            trace=<file> records the serial link of a single combination for replay, it ends with a
+ *                         capture dump
+ */
+
+const unsigned long LOOP_INTERVAL = 1000;  // firmware loop runs every second of virtual time
+const unsigned long PACKET_INTERVAL = 60000; // remote rooms send their temperature every minute
+const byte PACKET_ZONES = 8;               // max zones in a packet
+
+enum {
+  PERIOD, DURATION, TEMP_A, TEMP_B, TEMP_P, RESET_MINUTES, RESET_DROP, RESET_ABS, RESET_WAIT, N_SWEPT
+};
+
+struct Swept {
+  const char*         name;
+  std::vector<double> values;
+};
+
+Swept swept[N_SWEPT] = {
+  { "period",       { 0, 60, 240 } },
+  { "duration",     { 10, 30 } },
+  { "tempA",        { 18 } },
+  { "tempB",        { 14, 16, 18 } },
+  { "tempP",        { 18, 20 } },
+  { "resetMinutes", { 50 } },
+  { "resetDrop",    { -10 } },
+  { "resetAbs",     { 2100 } },
+  { "resetWait",    { 180 } },
+};
+
+struct Options {
+  int           days;
+  unsigned long seed;
+  int           jobs;
+  State::Mode   mode;
+  Plant::Params plant;
+  const char*   trace;
+};
+
+// Serial output of the node, passes reset signals to the plant and records output to trace
+class ResetSignal : public Print {
+public:
+  ResetSignal(Plant& plant, FILE* trace) : _plant(plant), _trace(trace) {}
+
+  virtual size_t write(uint8_t c) {
+    if (_trace)
+      fputc(c, _trace);
+    if (c == '\n') {
+      if (_line == "!RR\r")
+        _plant.reset();
+      _line.clear();
+    } else if (_line.size() < 8)
+      _line += (char)c;
+    return 1;
+  }
+
+private:
+  Plant&      _plant;
+  FILE*       _trace;
+  std::string _line;
+};
+
+// Serial input of the node, records it to trace
+void send(Node& node, const std::string& s, FILE* trace) {
+  if (trace)
+    fputs(s.c_str(), trace);
+  node.input(s.c_str());
+}
+
+std::string setupCommands(const Options& opt, const double* v) {
+  std::string s;
+  char buf[64];
+  snprintf(buf, sizeof(buf), "!CF%d\r\n!CP%d\r\n!CD%d\r\n!CAN10\r\n!CAX5\r\n!CAR0.2\r\n!C%d\r\n",
+    Force::AUTO, (int)v[PERIOD], (int)v[DURATION], opt.mode);
+  s += buf;
+  for (byte i = 0; i < opt.plant.rooms; i++) {
+    snprintf(buf, sizeof(buf), "!CT%dA%.1f\r\n!CT%dB%.1f\r\n!CT%dP%.1f\r\n",
+      i, v[TEMP_A], i, v[TEMP_B], i, v[TEMP_P]);
+    s += buf;
+  }
+  return s;
+}
+
+std::string packets(Plant& plant, byte rooms) {
+  std::string s;
+  char buf[16];
+  for (byte i = 1; i < rooms; i++) {
+    snprintf(buf, sizeof(buf), "%c%d:%.1f", (i - 1) % PACKET_ZONES == 0 ? '[' : ',', i, plant.room(i));
+    s += buf;
+    if (i % PACKET_ZONES == 0 || i == rooms - 1)
+      s += "]\r\n";
+  }
+  return s;
+}
+
+Plant::Stats run(const Options& opt, const double* v) {
+  Controller::ResetLimits limits = {
+    (long)(v[RESET_WAIT] * Timeout::SECOND), (int)v[RESET_MINUTES], (int)v[RESET_DROP], (int)v[RESET_ABS]
+  };
+  Node node(limits);
+  Plant plant(node.board, opt.plant, opt.seed);
+  FILE* trace = opt.trace ? fopen(opt.trace, "w") : 0;
+  ResetSignal out(plant, trace);
+  node.output(&out);
+  send(node, setupCommands(opt, v), trace);
+  node.drain();
+  unsigned long time = node.board.time();
+  unsigned long end = time + opt.days * Timeout::DAY;
+  unsigned long packetTime = time;
+  while (time < end) {
+    unsigned long now = node.board.time();
+    plant.step(now - time);
+    time = now;
+    node.sensor.set(Sensor::temp_t((int)lround(plant.room(0) * 16) * 100 / 16)); // DS18B20 resolution
+    if ((long)(time - packetTime) >= 0) {
+      packetTime += PACKET_INTERVAL;
+      send(node, packets(plant, opt.plant.rooms), trace);
+    }
+    node.loop();
+    node.board.advance(LOOP_INTERVAL);
+  }
+  if (trace) {
+    send(node, "!CX\r\n", trace); // the trace ends with the capture for replay -x
+    node.drain();
+    fclose(trace);
+  }
+  return plant.stats;
+}
+
+// Values of i-th combination, the first parameter changes slowest
+void combination(size_t i, double* v) {
+  for (int k = N_SWEPT - 1; k >= 0; k--) {
+    v[k] = swept[k].values[i % swept[k].values.size()];
+    i /= swept[k].values.size();
+  }
+}
+
+void sweep(const Options& opt, size_t n, std::vector<Plant::Stats>& results) {
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> jobs;
+  for (int k = 0; k < opt.jobs; k++)
+    jobs.push_back(std::thread([&]() {
+      for (size_t i = next++; i < n; i = next++) {
+        double v[N_SWEPT];
+        combination(i, v);
+        results[i] = run(opt, v);
+      }
+    }));
+  for (size_t k = 0; k < jobs.size(); k++)
+    jobs[k].join();
+}
+
+void usage() {
+  fprintf(stderr, "Usage: sweep [<name>=<value>[,<value>...] ...]\n  swept:");
+  for (int k = 0; k < N_SWEPT; k++)
+    fprintf(stderr, " %s", swept[k].name);
+  fprintf(stderr, "\n  options: days seed jobs rooms lockouts outside=mild|cold|front mode=working|timer|off trace\n");
+  exit(1);
+}
+
+void parseArg(Options& opt, const char* arg) {
+  const char* eq = strchr(arg, '=');
+  if (!eq)
+    usage();
+  std::string name(arg, eq - arg);
+  const char* value = eq + 1;
+  for (int k = 0; k < N_SWEPT; k++)
+    if (name == swept[k].name) {
+      swept[k].values.clear();
+      for (const char* p = value; *p;) {
+        char* end;
+        swept[k].values.push_back(strtod(p, &end));
+        if (end == p || (*end != ',' && *end != 0))
+          usage();
+        p = *end ? end + 1 : end;
+      }
+      return;
+    }
+  if (name == "days")
+    opt.days = atoi(value);
+  else if (name == "seed")
+    opt.seed = strtoul(value, 0, 0);
+  else if (name == "jobs")
+    opt.jobs = max(atoi(value), 1);
+  else if (name == "rooms")
+    opt.plant.rooms = constrain(atoi(value), 1, min((int)Plant::MAX_ROOMS, TempZones::N_ZONES));
+  else if (name == "trace")
+    opt.trace = value;
+  else if (name == "lockouts")
+    opt.plant.lockouts = atof(value);
+  else if (name == "outside" && !strcmp(value, "mild"))
+    opt.plant.outside = Plant::MILD;
+  else if (name == "outside" && !strcmp(value, "cold"))
+    opt.plant.outside = Plant::COLD;
+  else if (name == "outside" && !strcmp(value, "front"))
+    opt.plant.outside = Plant::FRONT;
+  else if (name == "mode" && !strcmp(value, "working"))
+    opt.mode = State::MODE_WORKING;
+  else if (name == "mode" && !strcmp(value, "timer"))
+    opt.mode = State::MODE_TIMER;
+  else if (name == "mode" && !strcmp(value, "off"))
+    opt.mode = State::MODE_OFF;
+  else
+    usage();
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  opt.days = 7;
+  opt.seed = 1;
+  opt.jobs = max((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+  opt.mode = State::MODE_OFF;
+  opt.plant = Plant::DEFAULT_PARAMS;
+  opt.trace = 0;
+  for (int i = 1; i < argc; i++)
+    parseArg(opt, argv[i]);
+
+  size_t n = 1;
+  for (int k = 0; k < N_SWEPT; k++)
+    n *= swept[k].values.size();
+  if (opt.trace && n != 1)
+    usage(); // trace of a single combination only
+  std::vector<Plant::Stats> results(n);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  sweep(opt, n, results);
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  for (int k = 0; k < N_SWEPT; k++)
+    printf("%s ", swept[k].name);
+  printf("| comfort starts duty lockout resets false\n");
+  for (size_t i = 0; i < n; i++) {
+    double v[N_SWEPT];
+    combination(i, v);
+    for (int k = 0; k < N_SWEPT; k++)
+      printf("%*g ", (int)strlen(swept[k].name), v[k]);
+    Plant::Stats& s = results[i];
+    printf("| %7.0f %6lu %4.1f %7.0f %6u %5u\n", s.comfortMinutes, s.burnerStarts,
+      s.burnerHours * 100 / (opt.days * 24), s.lockoutMinutes, s.resets, s.falseResets);
+  }
+  fflush(stdout);
+  fprintf(stderr, "%zu runs of %d days in %.1f s on %d jobs, %.0f simulated days per second\n",
+    n, opt.days, time.count(), opt.jobs, n * opt.days / time.count());
+  return 0;
+}
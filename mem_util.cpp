@@ -0,0 +1,38 @@
+#include "mem_util.h"
+
+const byte PAINT = 0xc5;
+
+extern byte __data_start; // start of static data
+extern byte _end;         // end of static data (.bss)
+extern byte __stack;      // top of RAM
+extern byte* __brkval;    // top of heap or zero when malloc was not used
+
+// Runs from .init3 right after stack pointer is set and before static constructors, it must
+// not use stack as it is naked
+void paintRam() __attribute__ ((naked, used, section (".init3")));
+
+void paintRam() {
+  byte* p = &_end;
+  while (p <= &__stack)
+    *p++ = PAINT;
+}
+
+// Returns the lowest address the stack has ever reached
+byte* stackLow() {
+  byte* p = __brkval != 0 ? __brkval : &_end;
+  while (p <= &__stack && *p == PAINT)
+    p++;
+  return p;
+}
+
+unsigned int staticRamSize() {
+  return &_end - &__data_start;
+}
+
+unsigned int stackPeak() {
+  return &__stack - stackLow() + 1;
+}
+
+unsigned int freeRamMin() {
+  return stackLow() - (__brkval != 0 ? __brkval : &_end);
+}
@@ -0,0 +1,16 @@
+#ifndef MEM_UTIL_H_
+#define MEM_UTIL_H_
+
+#include <Arduino.h>
+
+/*
+ * SRAM between the end of static data and the top of the stack is painted before constructors
+ * run, so the deepest stack ever reached is where the paint ends. Use for diagnostics only,
+ * stackPeak and freeRamMin scan the free memory.
+ */
+
+unsigned int staticRamSize(); // .data and .bss bytes
+unsigned int stackPeak();     // max stack bytes used since boot
+unsigned int freeRamMin();    // min free bytes between heap and stack since boot
+
+#endif /* MEM_UTIL_H_ */
@@ -0,0 +1,214 @@
+#include <avr/interrupt.h>
+#include "onewire_bus.h"
+#include "xprint.h"
+
+// Timer2 runs at F_CPU/32, that is 2 us per tick on 16 MHz
+const byte US_PER_TICK = 2;
+
+// Slot timings in us per Maxim application note 126
+const byte RESET_LOW_US     = 240; // twice, 480 us total
+const byte RESET_SAMPLE_US  = 70;
+const byte RESET_DONE_US    = 205; // twice, 410 us total
+const byte WRITE_1_LOW_US   = 6;
+const byte WRITE_1_DONE_US  = 64;
+const byte WRITE_0_LOW_US   = 60;
+const byte WRITE_0_DONE_US  = 10;
+const byte READ_LOW_US      = 6;
+const byte READ_SAMPLE_US   = 9;
+const byte READ_DONE_US     = 55;
+
+const byte CRC8_TABLE[256] PROGMEM = {
+  0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+  0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+  0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+  0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+  0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+  0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+  0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+  0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+  0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+  0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+  0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+  0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+  0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+  0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+  0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+  0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+
+OneWireBus* busInstance;
+
+ISR(TIMER2_COMPA_vect) {
+  busInstance->step();
+}
+
+OneWireBus::OneWireBus(byte pin) {
+  _mask = digitalPinToBitMask(pin);
+  byte port = digitalPinToPort(pin);
+  _in = portInputRegister(port);
+  _mode = portModeRegister(port);
+  _out = portOutputRegister(port);
+}
+
+void OneWireBus::setup() {
+  busInstance = this;
+  release();
+  TIMSK2 = 0;
+  TCCR2A = 1 << WGM21;                // CTC mode
+  TCCR2B = (1 << CS21) | (1 << CS20); // F_CPU/32
+}
+
+boolean OneWireBus::submit(Transaction* t) {
+  byte next = (_tail + 1) % QUEUE_SIZE;
+  if (next == _head)
+    return false; // queue is full
+  t->presence = false;
+  _queue[_tail] = t;
+  noInterrupts();
+  _tail = next;
+  if (!_running)
+    begin();
+  interrupts();
+  return true;
+}
+
+void OneWireBus::poll() {
+  while (_head != _active) { // atomic read of _active
+    Transaction* t = _queue[_head];
+    _head = (_head + 1) % QUEUE_SIZE;
+    if (t->callback)
+      t->callback(*t);
+  }
+}
+
+boolean OneWireBus::idle() {
+  return _head == _tail;
+}
+
+byte OneWireBus::crc8(const byte* data, byte len) {
+  byte crc = 0;
+  while (len-- > 0)
+    crc = pgm_read_byte_near(&CRC8_TABLE[crc ^ *data++]);
+  return crc;
+}
+
+// ----------- Interrupt-driven state machine (interrupts are disabled here) -----------
+
+// Starts transaction at _active position with a reset pulse
+void OneWireBus::begin() {
+  _running = true;
+  _pos = 0;
+  _bit = 1;
+  driveLow();
+  _phase = RESET_RELEASE;
+  schedule(RESET_LOW_US);
+}
+
+void OneWireBus::step() {
+  Transaction* t = _queue[_active];
+  switch (_phase) {
+  case RESET_RELEASE:
+    if (_bit != 0) {
+      _bit = 0; // first half of reset low time is over
+      schedule(RESET_LOW_US);
+      break;
+    }
+    release();
+    _phase = RESET_SAMPLE;
+    schedule(RESET_SAMPLE_US);
+    break;
+  case RESET_SAMPLE:
+    t->presence = !readPin();
+    _bit = 1;
+    _phase = RESET_DONE;
+    schedule(RESET_DONE_US);
+    break;
+  case RESET_DONE:
+    if (_bit != 0) {
+      _bit = 0; // first half of reset recovery is over
+      schedule(RESET_DONE_US);
+      break;
+    }
+    if (!t->presence) {
+      finish(); // nobody is there
+      break;
+    }
+    _bit = 1;
+    nextBit();
+    break;
+  case BIT_RELEASE:
+    release(); // end of write 0 slot
+    _phase = BIT_DONE;
+    schedule(WRITE_0_DONE_US);
+    break;
+  case BIT_DONE:
+    _bit <<= 1;
+    if (_bit == 0) {
+      _bit = 1;
+      _pos++;
+    }
+    nextBit();
+    break;
+  }
+}
+
+void OneWireBus::nextBit() {
+  Transaction* t = _queue[_active];
+  if (_pos >= t->writeSize + t->readSize) {
+    finish();
+    return;
+  }
+  _phase = BIT_DONE;
+  if (_pos < t->writeSize) {
+    if (t->data[_pos] & _bit) {
+      driveLow();
+      delayMicroseconds(WRITE_1_LOW_US);
+      release();
+      schedule(WRITE_1_DONE_US);
+    } else {
+      driveLow();
+      _phase = BIT_RELEASE;
+      schedule(WRITE_0_LOW_US);
+    }
+  } else {
+    driveLow();
+    delayMicroseconds(READ_LOW_US);
+    release();
+    delayMicroseconds(READ_SAMPLE_US);
+    if (readPin())
+      t->data[_pos] |= _bit;
+    else
+      t->data[_pos] &= ~_bit;
+    schedule(READ_DONE_US);
+  }
+}
+
+void OneWireBus::finish() {
+  TIMSK2 = 0;
+  _active = (_active + 1) % QUEUE_SIZE;
+  if (_active != _tail)
+    begin();
+  else
+    _running = false;
+}
+
+inline void OneWireBus::driveLow() {
+  *_out &= ~_mask;
+  *_mode |= _mask;
+}
+
+inline void OneWireBus::release() {
+  *_mode &= ~_mask;
+  *_out &= ~_mask; // no pullup, bus has external one
+}
+
+inline boolean OneWireBus::readPin() {
+  return (*_in & _mask) != 0;
+}
+
+inline void OneWireBus::schedule(byte us) {
+  TCNT2 = 0;
+  OCR2A = us / US_PER_TICK - 1;
+  TIFR2 = 1 << OCF2A;
+  TIMSK2 = 1 << OCIE2A;
+}
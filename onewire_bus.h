@@ -0,0 +1,84 @@
+#ifndef ONEWIRE_BUS_H_
+#define ONEWIRE_BUS_H_
+
+#include <Arduino.h>
+
+/**
+ * Asynchronous 1-Wire transport. Reset, write and read slots are advanced from Timer2 compare
+ * interrupt, so the main loop only submits transactions and gets completion callbacks from poll().
+ * Only one instance is supported, as it owns Timer2.
+ */
+class OneWireBus {
+public:
+  static const byte MAX_DATA = 20;
+  static const byte QUEUE_SIZE = 4;
+
+  class Transaction;
+  typedef void (*Callback)(Transaction& t);
+
+  /**
+   * Bus transaction: reset pulse, then writeSize bytes from data[], then readSize bytes
+   * are read into data[] after the written ones.
+   */
+  class Transaction {
+  public:
+    byte              data[MAX_DATA];
+    byte              writeSize;
+    byte              readSize;
+    volatile boolean  presence;  // true when some device responded to reset pulse
+    Callback          callback;  // invoked from poll() on completion
+    void*             context;   // arbitrary pointer for callback
+  };
+
+  OneWireBus(byte pin);
+
+  void setup();
+  
+  /** Queues transaction, returns false when queue is full. */
+  boolean submit(Transaction* t);
+  
+  /** Invokes callbacks for completed transactions, call it from the main loop. */
+  void poll();
+
+  /** Returns true when there are no submitted transactions. */
+  boolean idle();
+
+  /** Table-driven Dallas/Maxim CRC8. */
+  static byte crc8(const byte* data, byte len);
+
+  void step(); // for ISR only
+
+private:
+  enum Phase {
+    RESET_RELEASE,
+    RESET_SAMPLE,
+    RESET_DONE,
+    BIT_RELEASE,
+    BIT_DONE
+  };
+
+  byte                   _mask;
+  volatile byte*         _in;
+  volatile byte*         _mode;
+  volatile byte*         _out;
+  
+  Transaction* volatile  _queue[QUEUE_SIZE];
+  volatile byte          _head;    // first transaction to dispatch callback for (main loop)
+  volatile byte          _active;  // transaction being executed (ISR)
+  volatile byte          _tail;    // next free queue position (main loop)
+  volatile boolean       _running;
+  
+  Phase                  _phase;
+  byte                   _pos;     // current byte in data[]
+  byte                   _bit;     // current bit mask in byte
+
+  void begin();
+  void nextBit();
+  void finish();
+  void driveLow();
+  void release();
+  boolean readPin();
+  void schedule(byte us);
+};
+
+#endif /* ONEWIRE_BUS_H_ */
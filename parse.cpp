@@ -1,200 +1,508 @@
 #include <Arduino.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
 #include "FixNum.h"
 #include "Config.h"
+#include "Capture.h"
+#include "ReportLog.h"
+#include "xprint.h"
 #include "parse.h"
 
+
+// ----------- grammar -----------
+
+const byte SYNTAX_NONE       = 0; // <prefix>, result is returned right away
+const byte SYNTAX_BYTE       = 1; // <prefix><n><eoln>, n is stored to field
+const byte SYNTAX_INDEX_BYTE = 2; // <prefix><i>':'<n><eoln>, n is stored to i-th element of field
+const byte SYNTAX_BYTE_PAIR  = 3; // <prefix><n1>':'<n2><eoln>, n1 is stored to field, n2 to field + stride
+const byte SYNTAX_INDEX_TEMP = 4; // <prefix><i><type><temp><eoln>, temp is stored to i-th element of field at type offset
+const byte SYNTAX_TEMP       = 5; // <prefix><temp><eoln>, temp is stored to field
+const byte SYNTAX_BACKFILL   = 6; // <prefix><seq><eoln>, reports since seq are requested from report log
+const byte SYNTAX_FRAME      = 7; // <prefix><seq>':'<command>, command is framed with sequence number
+const byte SYNTAX_PACKET     = 8; // <prefix><zone>':'<temp>[','<zone>':'<temp>...]['#'<hex>]']'
+
+typedef Parser::Rule Rule;
+
+const byte MAX_PREFIX = Rule::MAX_PREFIX;
+
+#define CMD(c)       { '!', 'C', c }
+#define CMD2(c1, c2) { '!', 'C', c1, c2 }
+#define FIELD(f)     offsetof(Config, f)
+
+/**
+ * Grammar of all commands and packets. The rule is chosen when all chars of its prefix were read,
+ * then its arguments are read according to its syntax. Config fields are written directly to EEPROM.
+ * Rules with the same command char (after "!C") must be adjacent.
+ */
+constexpr Rule RULES[] PROGMEM = {
+  // prefix                   syntax             result              limit                 stride                  field
+  { CMD(CMD_DUMP_STATE),      SYNTAX_NONE,       CMD_DUMP_STATE },
+  { CMD(CMD_DUMP_CONFIG),     SYNTAX_NONE,       CMD_DUMP_CONFIG },
+  { CMD(CMD_DUMP_ZONES),      SYNTAX_NONE,       CMD_DUMP_ZONES },
+  { CMD(CMD_DUMP_INFO),       SYNTAX_NONE,       CMD_DUMP_INFO },
+  { CMD(CMD_DUMP_TRENDS),     SYNTAX_NONE,       CMD_DUMP_TRENDS },
+  { CMD(CMD_DUMP_USAGE),      SYNTAX_NONE,       CMD_DUMP_USAGE },
+  { CMD(CMD_DUMP_RECORDER),   SYNTAX_NONE,       CMD_DUMP_RECORDER },
+  { CMD(CMD_DUMP_CAPTURE),    SYNTAX_NONE,       CMD_DUMP_CAPTURE },
+  { CMD(CMD_BEACON),          SYNTAX_NONE,       CMD_BEACON },
+  { CMD('1'),                 SYNTAX_NONE,       '1' },
+  { CMD('2'),                 SYNTAX_NONE,       '2' },
+  { CMD('3'),                 SYNTAX_NONE,       '3' },
+  { CMD('4'),                 SYNTAX_NONE,       '4' },
+  { CMD('H'),                 SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(hotwater) },
+  { CMD('F'),                 SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(force) },
+  { CMD('P'),                 SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(period) },
+  { CMD('D'),                 SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(duration) },
+  { CMD('E'),                 SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(corridor) },
+  { CMD2('A', 'N'),           SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(reportMin) },
+  { CMD2('A', 'X'),           SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(reportMax) },
+  { CMD2('A', 'R'),           SYNTAX_TEMP,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(reportTemp) },
+  { CMD('T'),                 SYNTAX_INDEX_TEMP, CMD_CONFIG_CHANGED, TempZones::N_ZONES,   sizeof(Config::Zone),   FIELD(zone) },
+  { CMD('S'),                 SYNTAX_INDEX_BYTE, CMD_CONFIG_CHANGED, DS18B20::MAX_SENSORS, sizeof(Config::Sensor), FIELD(sensor) + offsetof(Config::Sensor, zone) },
+  { CMD('N'),                 SYNTAX_BYTE_PAIR,  CMD_CONFIG_CHANGED, 0,                    FIELD(slotCount) - FIELD(slotNode), FIELD(slotNode) },
+  { CMD('Q'),                 SYNTAX_BYTE,       CMD_CONFIG_CHANGED, 0,                    0,                      FIELD(reportSeq) },
+  { CMD('B'),                 SYNTAX_BACKFILL,   CMD_DONE },
+  { CMD('#'),                 SYNTAX_FRAME,      0 },
+  { { '[' },                  SYNTAX_PACKET,     0,                  TempZones::N_ZONES }, // zone 0 is local and is never received
+};
+
+const byte N_RULES = sizeof(RULES) / sizeof(RULES[0]);
+const byte NO_RULE = 0xff;
+
+// Finds the first rule starting from i that has char c at position pos of its prefix (at compile time)
+constexpr byte findRule(byte pos, char c, byte i) {
+  return i == N_RULES ? NO_RULE : RULES[i].prefix[pos] == c ? i : findRule(pos, c, i + 1);
+}
+
+// Checks that each rule starting from i is the first one with its command char or follows the same one
+constexpr boolean groupedFrom(byte i) {
+  return i == N_RULES || ((findRule(2, RULES[i].prefix[2], 0) == i || RULES[i - 1].prefix[2] == RULES[i].prefix[2]) &&
+    groupedFrom(i + 1));
+}
+
+static_assert(N_RULES < NO_RULE, "too many rules");
+static_assert(groupedFrom(1), "rules with the same command char must be adjacent");
+
+// ----------- index -----------
+
+// The first char of every prefix is either CMD_LEAD or PACKET_LEAD, so most bytes of foreign traffic
+// are rejected by two comparisons. Every command continues with CMD_LEAD2, and then its rule is found
+// by the command char in the index below.
+
+const char CMD_LEAD = '!';
+const char CMD_LEAD2 = 'C';
+const char PACKET_LEAD = '[';
+const byte CMD_POS = 2; // position of command char in prefix
+const byte CMD_RULE = findRule(0, CMD_LEAD, 0);
+const byte PACKET_RULE = findRule(0, PACKET_LEAD, 0);
+
+// Checks that each rule starting from i is either a packet or a command that starts with CMD_LEAD, CMD_LEAD2
+constexpr boolean leadsFrom(byte i) {
+  return i == N_RULES || ((RULES[i].prefix[0] == PACKET_LEAD ||
+    (RULES[i].prefix[0] == CMD_LEAD && RULES[i].prefix[1] == CMD_LEAD2)) && leadsFrom(i + 1));
+}
+
+static_assert(CMD_RULE != NO_RULE && PACKET_RULE != NO_RULE, "no rules for lead chars");
+static_assert(leadsFrom(0), "rules must start with CMD_LEAD, CMD_LEAD2 or with PACKET_LEAD");
+
+const char MIN_CMD_CHAR = '#';
+const char MAX_CMD_CHAR = 'Z';
+
+#define CMD_INDEX_4(c) findRule(CMD_POS, c, 0), findRule(CMD_POS, c + 1, 0), findRule(CMD_POS, c + 2, 0), findRule(CMD_POS, c + 3, 0)
+#define CMD_INDEX_8(c) CMD_INDEX_4(c), CMD_INDEX_4(c + 4)
+
+// The first rule for each command char from MIN_CMD_CHAR to MAX_CMD_CHAR or NO_RULE
+const byte CMD_INDEX[] PROGMEM = {
+  CMD_INDEX_8('#'), CMD_INDEX_8('+'), CMD_INDEX_8('3'), CMD_INDEX_8(';'), CMD_INDEX_8('C'), CMD_INDEX_8('K'), CMD_INDEX_8('S')
+};
+
+static_assert(sizeof(CMD_INDEX) == MAX_CMD_CHAR - MIN_CMD_CHAR + 1, "command index does not cover all command chars");
+
+// types of SYNTAX_INDEX_TEMP in the order of Config::Zone fields
+const char TEMP_TYPES[] = "ABP";
+
+// ----------- engine -----------
+
 const byte PARSE_ANY    = 0;
-const byte PARSE_ATTN   = 1;      // Attention char '!' received, wait for 'C'
-const byte PARSE_CMD    = 2;      // '!C' was read, wait for command char
-const byte PARSE_TVAL   = 3;      // '!CT'<arg><type> was read, wait for temp value
-const byte PARSE_X_ARG  = 4;      // '[' was read, wait for zone id (in parseArg)
-const byte PARSE_X_VAL0 = 5;      // '['<arg>':' was read, wait for temp value (skip spaces)
-const byte PARSE_X_VAL  = 6;      // .. continues to read value
-const byte PARSE_X_FIN  = 7;      // wait for final ']'
-
-const byte PARSE_HOTWATER = 'H';    // '!CH' was read, wait for arg
-const byte PARSE_FORCE    = 'F';    // '!CF' was read, wait for arg
-const byte PARSE_PERIOD   = 'P';    // '!CP' was read, wait for arg
-const byte PARSE_DURATION = 'D';    // '!CD' was read, wait for arg
-const byte PARSE_TEMP     = 'T';    // '!CT' was read, wait for arg
-
-const byte TEMP_TYPE_A     = 'A';
-const byte TEMP_TYPE_B     = 'B';
-const byte TEMP_TYPE_P     = 'P';
-
-byte parseState = PARSE_ANY;
-byte parseArg;
-byte parseTempType;
-
-typedef FixNumParser<int> temp_parser_t;
-temp_parser_t parseTempVal;
-
-char parseChar(char ch) {
-  boolean eoln = ch == '\r' || ch == '\n';
-  switch (parseState) {
-    case PARSE_X_FIN:
-      if (ch == ']') {
-        // temperature packet '['<arg>':' ... <temp> ... ']' is over
-        tempZones.temp[parseArg].setReceived(parseTempVal);        
-        parseState = PARSE_ANY;
+const byte PARSE_PREFIX = 1;      // _len chars of _index rule prefix were read
+const byte PARSE_ARG    = 2;      // rule prefix was read, wait for arg
+const byte PARSE_ARG2   = 3;      // <arg>':' was read, wait for second arg
+const byte PARSE_TVAL   = 4;      // wait for temp value to store into _field
+const byte PARSE_SEQ    = 5;      // wait for sequence number
+const byte PARSE_X_ARG  = 6;      // '[' was read, wait for zone id (in _arg)
+const byte PARSE_X_VAL0 = 7;      // '['<arg>':' was read, wait for temp value (skip spaces)
+const byte PARSE_X_VAL  = 8;      // .. continues to read value
+const byte PARSE_X_FIN  = 9;      // wait for final ']'
+const byte PARSE_X_SUM  = 10;     // '['<arg>':'<temp>...'#' was read, wait for hex checksum and ']'
+
+Parser::Parser(Stream& in, Print& out, Hal& hal, Config& config, TempZones& zones, Force& force,
+    ReportLog& reportLog, Capture& capture) :
+  _in(in),
+  _out(out),
+  _hal(hal),
+  _config(config),
+  _zones(zones),
+  _force(force),
+  _reportLog(reportLog),
+  _capture(capture),
+  _state(PARSE_ANY),
+  _index(0),
+  _len(0),
+  _rule(),
+  _arg(0),
+  _slot(0),
+  _field(0),
+  _seq(0),
+  _tempVal(),
+  _framed(false),
+  _frameRetry(false),
+  _frameSeq(0),
+  _lastFrameSeq(0),
+  _recentFrames(),
+  _recentFramesHead(0),
+  _recentFramesSize(0),
+  _sum(0),
+  _batchSize(0),
+  _batchZone(),
+  _batchTemp()
+{}
+
+inline char prefixChar(byte index, byte pos) {
+  return pos < MAX_PREFIX ? pgm_read_byte(&RULES[index].prefix[pos]) : 0;
+}
+
+// Finds rule that continues already matched prefix with ch
+inline boolean Parser::matchPrefix(char ch) {
+  if (ch == 0)
+    return false; // never matches zero padding of prefixes
+  byte index = NO_RULE;
+  if (_len == 0)
+    index = ch == CMD_LEAD ? CMD_RULE : ch == PACKET_LEAD ? PACKET_RULE : NO_RULE;
+  else if (_len == 1)
+    index = ch == CMD_LEAD2 ? CMD_RULE : NO_RULE; // only commands have a longer prefix
+  else if (_len == CMD_POS)
+    index = ch >= MIN_CMD_CHAR && ch <= MAX_CMD_CHAR ? pgm_read_byte(&CMD_INDEX[ch - MIN_CMD_CHAR]) : NO_RULE;
+  else {
+    // _index is the first rule with matched prefix and the others are right after it
+    char last = prefixChar(_index, _len - 1);
+    for (byte i = _index; i < N_RULES && prefixChar(i, _len - 1) == last; i++)
+      if (prefixChar(i, _len) == ch) {
+        index = i;
         break;
       }
-      if (eoln) {
-        // line over w/o closing brace!
-        parseState = PARSE_ANY;
+  }
+  if (index == NO_RULE)
+    return false;
+  _index = index;
+  _len++;
+  return true;
+}
+
+inline boolean Parser::checkLimit() {
+  return _rule.limit == 0 || _arg < _rule.limit;
+}
+
+inline void Parser::storeField(unsigned int offset, byte value) {
+  if (_frameRetry)
+    return;
+  eeprom_write_byte((uint8_t*)&_config + offset, value);
+}
+
+void Parser::applyBatch() {
+  for (byte i = 0; i < _batchSize; i++)
+    _zones.setReceived(_batchZone[i], _batchTemp[i]);
+  _batchSize = 0;
+  _state = PARSE_ANY;
+}
+
+// Returns true if frame with this sequence number was recently executed. Sync frame (sequence number 0)
+// or a number out of the window around the newest frame (gateway restart) forgets all recent frames.
+boolean Parser::isRecentFrame() {
+  if (_frameSeq == 0 ||
+      ((unsigned int)(_frameSeq - _lastFrameSeq) > MAX_RECENT_FRAMES &&
+       (unsigned int)(_lastFrameSeq - _frameSeq) >= MAX_RECENT_FRAMES)) {
+    _recentFramesHead = 0;
+    _recentFramesSize = 0;
+    _lastFrameSeq = _frameSeq;
+    return false;
+  }
+  for (byte i = 0; i < _recentFramesSize; i++)
+    if (_recentFrames[i] == _frameSeq)
+      return true;
+  return false;
+}
+
+// Remembers executed frame
+void Parser::rememberFrame() {
+  if ((int)(_frameSeq - _lastFrameSeq) > 0)
+    _lastFrameSeq = _frameSeq;
+  _recentFrames[_recentFramesHead] = _frameSeq;
+  if (++_recentFramesHead == MAX_RECENT_FRAMES)
+    _recentFramesHead = 0;
+  if (_recentFramesSize < MAX_RECENT_FRAMES)
+    _recentFramesSize++;
+}
+
+char Parser::beginRule() {
+  _state = PARSE_ANY;
+  if (pgm_read_byte(&RULES[_index].syntax) == SYNTAX_NONE)
+    return pgm_read_byte(&RULES[_index].result); // command for external processing, the rule is not needed
+  memcpy_P(&_rule, &RULES[_index], sizeof(Rule));
+  _arg = 0;
+  switch (_rule.syntax) {
+    case SYNTAX_BYTE:
+    case SYNTAX_INDEX_BYTE:
+    case SYNTAX_BYTE_PAIR:
+    case SYNTAX_INDEX_TEMP:
+      _state = PARSE_ARG;
+      break;
+    case SYNTAX_TEMP:
+      _field = _rule.field;
+      _state = PARSE_TVAL;
+      _tempVal.reset();
+      break;
+    case SYNTAX_FRAME:
+      if (_framed)
+        break; // no nested frames
+      // falls through to read sequence number
+    case SYNTAX_BACKFILL:
+      _state = PARSE_SEQ;
+      _seq = 0;
+      break;
+    case SYNTAX_PACKET:
+      _state = PARSE_X_ARG;
+      _sum = 0;
+      _batchSize = 0;
+      break;
+  }
+  return 0;
+}
+
+char Parser::parseChar(char ch) {
+  if (_state == PARSE_ANY && ch != CMD_LEAD && ch != PACKET_LEAD)
+    return 0; // fast path for foreign traffic
+  boolean eoln = ch == '\r' || ch == '\n';
+  if (_state >= PARSE_X_ARG && _state <= PARSE_X_FIN && ch != '#')
+    _sum += ch;
+  switch (_state) {
+    case PARSE_X_VAL0:
+      if (ch == ' ')
+        break; // skip spaces
+      _state = PARSE_X_VAL;
+      // fall through to read number
+    case PARSE_X_VAL:
+      { // block to encapsulate result var
+        temp_parser_t::Result result = _tempVal.parse(ch);
+        if (result == temp_parser_t::NUM)
+          break; // continue parsing number
+        if (result == temp_parser_t::BAD) {
+          _state = PARSE_ANY;
+          break;
+        }
+        _state = PARSE_X_FIN;
+      }
+      // !!! fall through to parse this char in PARSE_X_FIN state
+    case PARSE_X_FIN:
+      if (ch == ']' || ch == ',' || ch == '#') {
+        // zone temperature is over
+        if (_batchSize >= MAX_BATCH) {
+          _state = PARSE_ANY; // too many zones in a packet
+          break;
+        }
+        _batchZone[_batchSize] = _arg;
+        _batchTemp[_batchSize] = _tempVal;
+        _batchSize++;
+        if (ch == ',') {
+          _state = PARSE_X_ARG;
+          _arg = 0;
+        } else if (ch == '#') {
+          _state = PARSE_X_SUM;
+          _seq = 0;
+        } else
+          applyBatch();
         break;
       }
-      if (ch != '[' && ch != '!')
+      if (ch != '[' && ch != '!' && !eoln)
         break; // wait for more chars
-      parseState = PARSE_ANY;  
+      _state = PARSE_ANY;
+      if (eoln)
+        break; // line over w/o closing brace!
       // !!! fall through to parse any -- some other packet begin while old one is not over yet
     case PARSE_ANY:
-      switch (ch) {
-        case '!':
-          parseState = PARSE_ATTN;
+      _len = 0;
+      // falls through to match the first prefix char
+    case PARSE_PREFIX:
+      if (!matchPrefix(ch)) {
+        _state = PARSE_ANY;
+        break;
+      }
+      if (prefixChar(_index, _len) != 0) {
+        _state = PARSE_PREFIX; // wait for more prefix chars
+        break;
+      }
+      return beginRule();
+    case PARSE_ARG:
+    case PARSE_ARG2:
+    case PARSE_X_ARG:
+      if (ch >= '0' && ch <= '9') {
+        byte digit = ch - '0';
+        if (_arg > (255 - digit) / 10) {
+          _state = PARSE_ANY; // reject number that does not fit into byte
           break;
-        case '[':
-          parseState = PARSE_X_ARG;
-          parseArg = 0;
-          break;     
+        }
+        _arg = _arg * 10 + digit;
+        break;
       }
+      if (_state == PARSE_X_ARG) {
+        if (ch == ':' && _arg > 0 && checkLimit()) {
+          _state = PARSE_X_VAL0;
+          _tempVal.reset();
+        } else
+          _state = PARSE_ANY;
+        break;
+      }
+      if (_state == PARSE_ARG) {
+        switch (_rule.syntax) {
+          case SYNTAX_BYTE:
+            if (eoln) {
+              storeField(_rule.field, _arg);
+              _state = PARSE_ANY;
+              return _rule.result;
+            }
+            break;
+          case SYNTAX_INDEX_BYTE:
+          case SYNTAX_BYTE_PAIR:
+            if (ch == ':' && checkLimit()) {
+              _slot = _arg;
+              _arg = 0;
+              _state = PARSE_ARG2;
+              return 0;
+            }
+            break;
+          case SYNTAX_INDEX_TEMP:
+            { // block to encapsulate type var
+              const char* type = ch ? strchr(TEMP_TYPES, ch) : 0;
+              if (type && checkLimit()) {
+                _field = _rule.field + _arg * _rule.stride + (type - TEMP_TYPES);
+                _state = PARSE_TVAL;
+                _tempVal.reset();
+                return 0;
+              }
+            }
+            break;
+        }
+      } else if (eoln) {
+        // second arg is over
+        if (_rule.syntax == SYNTAX_INDEX_BYTE)
+          storeField(_rule.field + _slot * _rule.stride, _arg);
+        else {
+          storeField(_rule.field, _slot);
+          storeField(_rule.field + _rule.stride, _arg);
+        }
+        _state = PARSE_ANY;
+        return _rule.result;
+      }
+      _state = PARSE_ANY;
       break;
-    case PARSE_ATTN:
-      parseState = (ch == 'C') ? PARSE_CMD : PARSE_ANY;
-      break;
-    case PARSE_CMD:
-      switch (ch) {
-        case CMD_DUMP_STATE: 
-        case CMD_DUMP_CONFIG:
-        case CMD_DUMP_ZONES:
-        case '1': 
-        case '2': 
-        case '3': 
-        case '4':
-          parseState = PARSE_ANY;
-          return ch; // command for external processing
-        case PARSE_HOTWATER:
-        case PARSE_FORCE:
-        case PARSE_PERIOD:
-        case PARSE_DURATION:
-        case PARSE_TEMP:
-          parseState = ch;
-          parseArg = 0;
+    case PARSE_X_SUM:
+      if (ch == ']') {
+        // checksummed packet is over, apply it only when checksum matches
+        if (_seq == _sum)
+          applyBatch();
+        _state = PARSE_ANY;
+        break;
+      }
+      { // block to encapsulate digit var
+        byte digit;
+        if (ch >= '0' && ch <= '9')
+          digit = ch - '0';
+        else if (ch >= 'A' && ch <= 'F')
+          digit = ch - 'A' + 10;
+        else if (ch >= 'a' && ch <= 'f')
+          digit = ch - 'a' + 10;
+        else {
+          _state = PARSE_ANY;
           break;
-        default:
-          parseState = PARSE_ANY;
+        }
+        _seq = _seq * 16 + digit;
+        if (_seq > 0xff)
+          _state = PARSE_ANY;
       }
       break;
-    case PARSE_TEMP:
-      switch (ch) {
-        case TEMP_TYPE_A: 
-        case TEMP_TYPE_B: 
-        case TEMP_TYPE_P:
-          if (parseArg > TempZones::N_ZONES) {
-            parseState = PARSE_ANY;
-          } else {
-            parseTempType = ch;
-            parseState = PARSE_TVAL;
-            parseTempVal.reset();
-          }
-          return 0;        
-      }
-      // falls through to parse arg
-    case PARSE_HOTWATER:
-    case PARSE_FORCE:
-    case PARSE_PERIOD:
-    case PARSE_DURATION:
-    case PARSE_X_ARG:
+    case PARSE_SEQ:
       if (ch >= '0' && ch <= '9') {
-        parseArg *= 10;
-        parseArg += ch - '0';
+        _seq = _seq * 10 + (ch - '0');
         break;
       }
-      if (parseState == PARSE_X_ARG) {
-        if (ch == ':' && parseArg > 0 && parseArg < TempZones::N_ZONES) {
-          parseState = PARSE_X_VAL0;
-          parseTempVal.reset();
-          break;
-        } else {
-          parseState = PARSE_ANY;
-          break;
+      _state = PARSE_ANY;
+      if (_rule.syntax == SYNTAX_FRAME) {
+        if (ch == ':') {
+          // framed command shares frame prefix except its last char
+          _frameSeq = _seq;
+          _frameRetry = isRecentFrame(); // before the command has any effect
+          _framed = true;
+          _len--;
+          _state = PARSE_PREFIX;
         }
+        break;
       }
-      // for states other than PARSE_X_xxx
       if (eoln) {
-        switch (parseState) {
-          case PARSE_HOTWATER:
-            config.hotwater = parseArg;
-            break;
-          case PARSE_FORCE:
-            config.force = (Force::Mode)parseArg;
-            break;
-          case PARSE_PERIOD:
-            config.period = parseArg;
-            break;
-          case PARSE_DURATION:
-            config.duration = parseArg;
-            break;
-        }
-        parseState = PARSE_ANY;
-        return CMD_DUMP_CONFIG;
+        if (!_frameRetry)
+          _reportLog.request(_seq);
+        return _rule.result;
       }
-      parseState = PARSE_ANY;
       break;
     case PARSE_TVAL:
       { // block to encapsulate result var
-        temp_parser_t::Result result = parseTempVal.parse(ch);
+        temp_parser_t::Result result = _tempVal.parse(ch);
         if (result != temp_parser_t::NUM) {
           if (eoln) {
-            Config::temp_t temp = result == temp_parser_t::BAD ? Config::temp_t::invalid() : parseTempVal;
-            switch (parseTempType) {
-              case TEMP_TYPE_A:
-                config.zone[parseArg].tempA = temp;
-                break;
-              case TEMP_TYPE_B:
-                config.zone[parseArg].tempB = temp;
-                break;
-              case TEMP_TYPE_P:
-                config.zone[parseArg].tempP = temp;
-                break;
-            }
-            parseState = PARSE_ANY;
-            return CMD_DUMP_CONFIG;
+            Config::temp_t temp = result == temp_parser_t::BAD ? Config::temp_t::invalid() : _tempVal;
+            storeField(_field, temp.mantissa());
+            if (_rule.syntax == SYNTAX_INDEX_TEMP && !_frameRetry)
+              _force.zoneChanged(_arg);
+            _state = PARSE_ANY;
+            return _rule.result;
           } else
-            parseState = PARSE_ANY;
+            _state = PARSE_ANY;
         }
       }
-      break;    
-    case PARSE_X_VAL0:
-      if (ch == ' ') 
-        break; // skip spaces
-      parseState = PARSE_X_VAL;  
-      // fall through to read number
-    case PARSE_X_VAL:
-      switch (parseTempVal.parse(ch)) {
-        case temp_parser_t::BAD:
-          parseState = PARSE_ANY;
-          break;
-        case temp_parser_t::DONE:
-          parseState = PARSE_X_FIN;
-          // recurse to parse this char in PARSE_X_FIN state and update state correspondingly
-          parseChar(ch);
-          break;  
-        case temp_parser_t::NUM:
-          break; // continue parsing number
-      }
-      break;  
+      break;
   }
   return 0;
 }
 
-char parseCommand() {
-  while (Serial.available()) {
-    char cmd = parseChar(Serial.read());
+void Parser::ackFrame(char result) {
+  _hal.waitPrint();
+  printFmtOn_C(_out, "[C%%]*\r\n", result, _frameSeq);
+}
+
+char Parser::parseCommand() {
+  while (_in.available()) {
+    char ch = _in.read();
+    if (_state != PARSE_ANY || ch == CMD_LEAD || ch == PACKET_LEAD)
+      _capture.addSerial(ch); // the bytes parser consumes
+    char cmd = parseChar(ch);
+    if (_framed && (cmd != 0 || _state == PARSE_ANY)) {
+      // framed command is over
+      _framed = false;
+      if (cmd == 0) {
+        ackFrame('-');
+        _frameRetry = false;
+        continue;
+      }
+      ackFrame('+');
+      if (_frameRetry) {
+        _frameRetry = false;
+        continue; // already executed
+      }
+      rememberFrame();
+      if (cmd == CMD_CONFIG_CHANGED)
+        continue; // does not need config dump
+      return cmd;
+    }
     if (cmd != 0)
       return cmd;
   }
   return 0;
 }
-
-
@@ -1,15 +1,121 @@
 #ifndef PARSE_H_
 #define PARSE_H_
 
+#include <Arduino.h>
+#include "FixNum.h"
+#include "Hal.h"
+#include "TempZones.h"
+
+class Config;
+class Force;
+class ReportLog;
+class Capture;
+
 const char CMD_DUMP_STATE  = '?';
 const char CMD_DUMP_CONFIG = 'C';
 const char CMD_DUMP_ZONES  = 'Z';
+const char CMD_DUMP_INFO   = 'I';
+const char CMD_DUMP_TRENDS = 'R';
+const char CMD_DUMP_USAGE  = 'U';
+const char CMD_DUMP_RECORDER = 'L';
+const char CMD_DUMP_CAPTURE = 'X';
+const char CMD_BEACON      = 'G';
+const char CMD_CONFIG_CHANGED = '=';
+const char CMD_DONE        = '+';
 
 /**
- * This function returns '?', 'C' or digits from '1' to '4' if it parsed
- * the corresponding command in the serial input stream. The result
- * is zero if there are no more characters in the serial input.
+ * Parser of commands and packets read from the input stream, frame acks are printed to the output.
+ * The board parser reads from and prints to the serial port, a host build may feed it from a
+ * recorded trace. Commands change config and zones, consumed bytes are recorded into capture.
  */
-char parseCommand();
+class Parser {
+public:
+  /** Rule of the grammar, see RULES in parse.cpp. */
+  struct Rule {
+    static const byte MAX_PREFIX = 4;
+
+    char         prefix[MAX_PREFIX]; // chars that start the command, zero-padded
+    byte         syntax;             // SYNTAX_xxx
+    char         result;             // returned from parseCommand when command is over, 0 for none
+    byte         limit;              // upper bound (exclusive) of index or zone, 0 for no check
+    byte         stride;             // size of indexed element of field
+    unsigned int field;              // offset of config field in EEPROM
+  };
+
+  Parser(Stream& in, Print& out, Hal& hal, Config& config, TempZones& zones, Force& force,
+    ReportLog& reportLog, Capture& capture);
+
+  /**
+   * Returns '?', 'C', 'Z', 'I', 'R', 'U', 'L', 'X', 'G', digits from '1' to '4' if it parsed
+   * the corresponding command in the input stream, '=' when config was changed, and '+' when
+   * the command was already fully processed. The result is zero if there are no more characters in
+   * the input.
+   *
+   * Commands can be framed with sequence number as '!C#'<seq>':'<command>. Framed commands are
+   * acknowledged with '[C+'<seq>']*' or rejected with '[C-'<seq>']*', they are executed only once
+   * when retried with the same sequence number, and config changes are not followed by config dump.
+   * A retry is detected before the command has any effect. The gateway numbers frames upwards and
+   * starts with the sync frame 0 after restart: frame 0 or a frame more than 8 numbers away from
+   * the newest one forgets all recent frames and is always executed.
+   *
+   * Remote zone temperatures are received as '['<zone>':'<temp>']'. A batched packet carries up to
+   * 8 zones as '['<zone>':'<temp>','<zone>':'<temp>...']' and may end with '#'<hex>']', where <hex>
+   * is the 8-bit sum of all chars between '[' and '#'. Zones of a packet are applied together and
+   * only when the whole packet (and checksum, if any) is valid.
+   */
+  char parseCommand();
+
+  /** Parses one char, returns the same as parseCommand except frames are not acknowledged. */
+  char parseChar(char ch);
+
+private:
+  static const byte MAX_RECENT_FRAMES = 8;
+  static const byte MAX_BATCH = 8;
+
+  typedef FixNumParser<int> temp_parser_t;
+
+  Stream&           _in;
+  Print&            _out;
+  Hal&              _hal;
+  Config&           _config;
+  TempZones&        _zones;
+  Force&            _force;
+  ReportLog&        _reportLog;
+  Capture&          _capture;
+
+  byte              _state;
+  byte              _index;       // matched rule
+  byte              _len;         // number of matched prefix chars
+  Rule              _rule;        // copy of matched rule
+  byte              _arg;
+  byte              _slot;
+  unsigned int      _field;
+  unsigned int      _seq;
+  temp_parser_t     _tempVal;
+
+  boolean           _framed;      // true when parsing framed command
+  boolean           _frameRetry;  // true when framed command was already executed, its side effects are skipped
+  unsigned int      _frameSeq;
+  unsigned int      _lastFrameSeq; // the newest executed frame
+  unsigned int      _recentFrames[MAX_RECENT_FRAMES];
+  byte              _recentFramesHead;
+  byte              _recentFramesSize;
+
+  byte              _sum;         // sum of chars after '[' for checksum
+  byte              _batchSize;
+  byte              _batchZone[MAX_BATCH];
+  TempZones::temp_t _batchTemp[MAX_BATCH];
+
+  Parser(const Parser& other); // no copy constructor
+
+  boolean matchPrefix(char ch);
+  boolean checkLimit();
+  void storeField(unsigned int offset, byte value);
+  void applyBatch();
+  boolean isRecentFrame();
+  void rememberFrame();
+  char beginRule();
+  void ackFrame(char result);
+};
 
 #endif /* PARSE_H_ */
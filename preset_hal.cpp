@@ -1,18 +1,31 @@
 #include "preset_hal.h"
+#include "Capture.h"
 
 //------- READ SETTINGS -------
 
 #define PRESET_TEMP_PIN A0
 #define PRESET_TIME_PIN A1
 
+int capturedPresetTemp = -1; // last values in capture
+int capturedPresetTime = -1;
+
 int getPresetTemp() {
   int in = analogRead(PRESET_TEMP_PIN);
-  return ((361241L + 500) - 324L * in) / 1000;
+  int temp = ((361241L + 500) - 324L * in) / 1000;
+  if (temp != capturedPresetTemp) {
+    capturedPresetTemp = temp;
+    capture.add(Capture::ANALOG | Capture::ANALOG_PRESET_TEMP, temp);
+  }
+  return temp;
 }
 
 int getPresetTime() {
   int in = analogRead(PRESET_TIME_PIN);
-  return ((19571L + 500) - 19L * in) / 1000;
+  int time = ((19571L + 500) - 19L * in) / 1000;
+  if (time != capturedPresetTime) {
+    capturedPresetTime = time;
+    capture.add(Capture::ANALOG | Capture::ANALOG_PRESET_TIME, time);
+  }
+  return time;
 }
 
-
@@ -0,0 +1,46 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <Arduino.h>
+#include "Timeout.h"
+
+/*
+ * Compile-time sizing profile of the target board. The lean profile fits ATmega328 (2 KB SRAM)
+ * and the large one uses the room of ATmega1280/2560 (8 KB SRAM). Sizes of the main objects
+ * (including Serial buffers) are checked against RAM_SIZE - STACK_RESERVE in c_main.cpp, and
+ * ram_check.sh checks everything the linker placed into RAM (virtual tables and the small globals
+ * too) against the same reserve.
+ */
+namespace Profile {
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+  const int  STACK_RESERVE  = 512;
+  const byte N_ZONES        = 64;
+  const byte N_SENSORS      = 16;  // DS18B20 sensors on the bus
+  const byte SENSOR_FILTER  = 8;   // raw reads in DS18B20 filter
+  const unsigned int HISTORY_SIZE = 720; // raw history samples, 3 hours
+  const byte N_RECORDS      = 192; // Recorder samples
+  const byte N_REPORTS      = 192; // ReportLog reports, 5 bytes each
+  const byte USAGE_HOURS    = 24;  // hourly Usage buckets
+  const byte USAGE_DAYS     = 7;   // daily Usage buckets
+  const int  CAPTURE_SIZE   = 768; // Capture ring bytes, about an hour of inputs
+#else
+  const int  STACK_RESERVE  = 224; // with the FmtLine of the dumps
+  const byte N_ZONES        = 10;
+  const byte N_SENSORS      = 8;
+  const byte SENSOR_FILTER  = 6;
+  const unsigned int HISTORY_SIZE = 0; // no raw history, the recorder keeps it
+  const byte N_RECORDS      = 64;
+  const byte N_REPORTS      = 64;  // an hour of minute reports
+  const byte USAGE_HOURS    = 6;
+  const byte USAGE_DAYS     = 2;
+  const int  CAPTURE_SIZE   = 96;  // the last few packets and state changes
+#endif
+
+  const byte SAMPLES_PER_HOUR = 240; // history samples, 15 s apart
+  const long HISTORY_INTERVAL = Timeout::HOUR / SAMPLES_PER_HOUR;
+
+  const int RAM_SIZE = RAMEND - RAMSTART + 1;
+  const int EEPROM_SIZE = E2END + 1;
+}
+
+#endif /* PROFILE_H_ */
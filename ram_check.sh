@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Post-link check of static RAM (.data, .bss, and .noinit) of the firmware against the stack
+# reserve of its profile (Profile::STACK_RESERVE in profile.h). The static_assert in c_main.cpp
+# sums only the main objects, this one sees everything the linker placed into RAM.
+#
+# Usage: ram_check.sh <elf> <reserve>
+#
+# To run it on every Arduino IDE build, add to platform.local.txt next to platform.txt of the AVR core:
+#   recipe.hooks.linking.postlink.1.pattern=/bin/sh "{build.source.path}/ram_check.sh" "{build.path}/{build.project_name}.elf" 192
+# with the reserve of the board profile (192 for ATmega328, 512 for ATmega1280/2560).
+
+if [ $# -ne 2 ]; then
+  echo "Usage: $0 <elf> <reserve>" >&2
+  exit 2
+fi
+
+ELF=$1
+RESERVE=$2
+NM=${AVR_NM:-avr-nm}
+
+symbol() {
+  ADDR=$($NM "$ELF" | awk -v name="$1" '$3 == name { print $1 }')
+  if [ -z "$ADDR" ]; then
+    echo "$ELF: no symbol $1" >&2
+    exit 2
+  fi
+  echo $((0x$ADDR))
+}
+
+DATA_START=$(symbol __data_start)
+END=$(symbol _end)
+STACK=$(symbol __stack)
+
+STATIC=$((END - DATA_START))
+FREE=$((STACK + 1 - END))
+echo "static RAM $STATIC bytes, $FREE bytes left for stack (reserve $RESERVE)"
+if [ $FREE -lt $RESERVE ]; then
+  echo "$ELF: static RAM exceeds budget by $((RESERVE - FREE)) bytes" >&2
+  exit 1
+fi
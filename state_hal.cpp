@@ -1,5 +1,6 @@
 #include "state_hal.h"
 #include "Timeout.h"
+#include "Capture.h"
 
 const long CHECK_STATE_INTERVAL = 100; // every 100 ms
 
@@ -19,6 +20,7 @@ volatile int readCounter; // number of times interrupt pin was triggered
 volatile byte errorCnt; // # of times error seen in ERROR_TIMEOUT = 0, 1, or 2+
 volatile long lastErrorTime; // last time error state was seen
 volatile byte turnedOnCache; // cached value of turned on state or UNKNOWN
+byte turnedOnCaptured = UNKNOWN; // last turned on state in capture
 
 boolean forcedOn; // last setForceOn value
 
@@ -32,6 +34,7 @@ void scanStateInterruptHandler() {
     bitWrite(newState, i, !digitalRead(statePins[i]));
   long time = millis();
   if (scanState != newState) {
+    capture.add(Capture::STATE, newState);
     scanState = newState;
     State::Mode newMode = curMode;
     for (int i = 0; i < MAX_MODE; i++)
@@ -98,6 +101,10 @@ boolean isTurnedOnCached() {
   byte cache = turnedOnCache; // atomic read
   if (cache == UNKNOWN) {
     on = analogRead(TURN_ON_PIN) > TURN_ON_THRESHOLD;
+    if (on != turnedOnCaptured) {
+      turnedOnCaptured = on;
+      capture.add(Capture::ANALOG | Capture::ANALOG_TURNED_ON, (int)on);
+    }
     turnedOnCache = on ? 1 : 0;
   } else
     on = cache > 0;
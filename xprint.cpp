@@ -1,25 +1,10 @@
 #include "xprint.h"
-#include "Timeout.h"
-
-const long INITIAL_PRINT_INTERVAL = 1000L; // wait 1 s before first print to get XBee time to initialize & join
-const long PRINT_INTERVAL         = 250L;  // wait 250 ms between prints 
-
-Timeout printTimeout(INITIAL_PRINT_INTERVAL);
+#include "fmt_util.h"
 
 void setupPrint() {
   Serial.begin(57600);  
 }
 
-void waitPrint() {
-  while (!printTimeout.check()); // just wait...
-  printTimeout.reset(PRINT_INTERVAL);
-}
-
-void waitPrintln(const char* s) {
-  waitPrint();
-  Serial.println(s);
-}
-
 void printOn_P(Print& out, PGM_P str) {
   while (1) {
     char ch = pgm_read_byte_near(str++);
@@ -33,3 +18,86 @@ void print_P(PGM_P str) {
   printOn_P(Serial, str); 
 }
 
+
+byte FmtArg::format(char* pos) const {
+  byte fmt = _fmt & ~KIND;
+  switch (_fmt & KIND) {
+    case AS_CHAR:
+      *pos = (char)_value;
+      return 1;
+    case AS_HEX:
+      for (byte i = _size; i-- > 0;)
+        *pos++ = HEX_CHARS[(_value >> (i * 4)) & 0xf];
+      return _size;
+    case BITS:
+      for (byte i = 0; i < _size; i++)
+        *pos++ = '0' + bitRead(_value, i);
+      return _size;
+    case FIXED:
+      formatDecimal(_value, pos, _size, fmt);
+      return _size;
+    case UNKNOWN:
+      formatDecimal(0, pos, _size, fmt);
+      for (byte i = 0; i < _size; i++)
+        if (pos[i] == '0')
+          pos[i] = '?';
+      return _size;
+  }
+  if (_value >= -INT_MAX && _value <= INT_MAX)
+    return formatDecimal((int)_value, pos, _size, FMT_LEFT | FMT_SPACE | fmt); // faster than long
+  return formatDecimal(_value, pos, _size, FMT_LEFT | FMT_SPACE | fmt);
+}
+
+FmtLine::FmtLine(Print& out) :
+  _out(out),
+  _size(0),
+  _buf()
+{}
+
+FmtLine::~FmtLine() {
+  flush();
+}
+
+void FmtLine::flush() {
+  if (_size != 0)
+    _out.write((const uint8_t*)_buf, _size);
+  _size = 0;
+}
+
+inline void FmtLine::put(char ch) {
+  if (_size == SIZE)
+    flush();
+  _buf[_size++] = ch;
+}
+
+size_t FmtLine::write(uint8_t c) {
+  put(c);
+  return 1;
+}
+
+size_t FmtLine::write(const uint8_t* buf, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    put(buf[i]);
+  return size;
+}
+
+void printFmtOn_P(FmtLine& line, PGM_P fmt, const FmtArg* args, byte count) {
+  while (1) {
+    char ch = pgm_read_byte_near(fmt++);
+    if (!ch)
+      return;
+    if (ch == '%' && count > 0) {
+      if (line._size > FmtLine::SIZE - FmtArg::MAX_SIZE)
+        line.flush();
+      line._size += args->format(&line._buf[line._size]);
+      args++;
+      count--;
+    } else
+      line.put(ch);
+  }
+}
+
+void printFmtOn_P(Print& out, PGM_P fmt, const FmtArg* args, byte count) {
+  FmtLine line(out);
+  printFmtOn_P(line, fmt, args, count);
+}
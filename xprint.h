@@ -3,12 +3,10 @@
 
 #include <Arduino.h>
 #include <avr/pgmspace.h>
+#include "FixNum.h"
 
 void setupPrint();
 
-void waitPrint();
-void waitPrintln(const char* s);
-
 void printOn_P(Print& out, PGM_P str);
 void print_P(PGM_P str);
 
@@ -21,6 +19,122 @@ void print_P(PGM_P str);
 #define printOn_C(out, str) { static const char _s[] PROGMEM = str; printOn_P(out, &_s[0]); }
 #define print_C(str)        { static const char _s[] PROGMEM = str; print_P(&_s[0]); }
 
+/**
+ * Argument of printFmt_C. Only types that can be formatted convert to it, integers are formatted
+ * in decimal, FixNums with their precision, chars as is, hex(x, digits) as fixed width hex,
+ * fixed(x, size) as fixed width decimal filled with zeroes (FixNums with sign, and '?' in place
+ * of digits when invalid), and bits(x, count) as '0' and '1' chars, the lowest bit first.
+ */
+class FmtArg {
+  public:
+    static const byte MAX_SIZE = 12; // max chars of formatted argument
+
+    FmtArg(char x);
+    FmtArg(byte x);
+    FmtArg(int x);
+    FmtArg(unsigned int x);
+    FmtArg(long x);
+    template<typename T, byte prec> FmtArg(FixNum<T, prec> x);
+
+    static FmtArg hex(unsigned int x, byte digits);
+    static FmtArg fixed(long x, byte size, byte prec = 0);
+    template<typename T, byte prec> static FmtArg fixed(FixNum<T, prec> x, byte size);
+    static FmtArg bits(byte x, byte count);
+
+    byte format(char* pos) const;
+
+  private:
+    // kind of argument in the upper bits of _fmt, the lower ones keep FMT_PREC and FMT_SIGN
+    static const byte KIND    = 0xe0;
+    static const byte DECIMAL = 0x00; // left aligned in at most _size chars
+    static const byte AS_CHAR = 0x20;
+    static const byte AS_HEX  = 0x40; // _size digits
+    static const byte FIXED   = 0x60; // right aligned in _size chars, filled with zeroes
+    static const byte UNKNOWN = 0x80; // like FIXED with '?' in place of digits
+    static const byte BITS    = 0xa0; // _size bits
+
+    FmtArg(long x, byte fmt, byte size);
+
+    long _value;
+    byte _fmt;
+    byte _size; // formatted size of decimals, overflows are filled with '9' like in FixNum::printTo
+};
+
+inline FmtArg::FmtArg(long x, byte fmt, byte size) : _value(x), _fmt(fmt), _size(size) {}
+inline FmtArg::FmtArg(char x) : _value(x), _fmt(AS_CHAR), _size(1) {}
+inline FmtArg::FmtArg(byte x) : _value(x), _fmt(DECIMAL), _size(MAX_SIZE) {}
+inline FmtArg::FmtArg(int x) : _value(x), _fmt(DECIMAL), _size(MAX_SIZE) {}
+inline FmtArg::FmtArg(unsigned int x) : _value(x), _fmt(DECIMAL), _size(MAX_SIZE) {}
+inline FmtArg::FmtArg(long x) : _value(x), _fmt(DECIMAL), _size(MAX_SIZE) {}
+
+template<typename T, byte prec> inline FmtArg::FmtArg(FixNum<T, prec> x) : 
+  _value(x.mantissa()), _fmt(DECIMAL | prec), _size(FixNumUtil::Limits<T>::bufSize - 1) {}
+
+inline FmtArg FmtArg::hex(unsigned int x, byte digits) {
+  return FmtArg(x, AS_HEX, digits);
+}
+
+inline FmtArg FmtArg::fixed(long x, byte size, byte prec) {
+  return FmtArg(x, FIXED | prec, size);
+}
+
+template<typename T, byte prec> inline FmtArg FmtArg::fixed(FixNum<T, prec> x, byte size) {
+  return FmtArg(x.mantissa(), (x.valid() ? FIXED : UNKNOWN) | FMT_SIGN | prec, size);
+}
+
+inline FmtArg FmtArg::bits(byte x, byte count) {
+  return FmtArg(x, BITS, count);
+}
+
+/**
+ * Output buffer of one line. Formatting into it goes to out in one write when the line is done
+ * (the buffer goes out of scope) and only longer lines are written in several pieces.
+ */
+class FmtLine : public Print {
+  public:
+    static const byte SIZE = 64;
+
+    FmtLine(Print& out);
+    ~FmtLine();
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t* buf, size_t size);
+    using Print::write;
+
+  private:
+    Print& _out;
+    byte   _size;
+    char   _buf[SIZE];
+
+    FmtLine(const FmtLine& other); // no copy constructor
+
+    void put(char ch);
+    void flush();
+
+    friend void printFmtOn_P(FmtLine& line, PGM_P fmt, const FmtArg* args, byte count);
+};
+
+void printFmtOn_P(FmtLine& line, PGM_P fmt, const FmtArg* args, byte count); // appends to line
+void printFmtOn_P(Print& out, PGM_P fmt, const FmtArg* args, byte count);   // prints as one line
+
+// Counts '%' in format string at compile time
+constexpr byte fmtArgCount(const char* str) {
+  return *str == 0 ? 0 : (*str == '%' ? 1 : 0) + fmtArgCount(str + 1);
+}
+
+/**
+ * Prints flash-resident format string replacing each '%' with the next argument (see FmtArg) in
+ * a single pass through one output buffer, which is out itself when it is FmtLine. The number of
+ * arguments is checked at compile time.
+ */
+#define printFmtOn_C(out, str, ...) { \
+  static const char _s[] PROGMEM = str; \
+  const FmtArg _a[] = { __VA_ARGS__ }; \
+  static_assert(fmtArgCount(str) == sizeof(_a) / sizeof(_a[0]), "wrong number of arguments for format"); \
+  printFmtOn_P(out, &_s[0], _a, sizeof(_a) / sizeof(_a[0])); }
+
+#define printFmt_C(str, ...) printFmtOn_C(Serial, str, __VA_ARGS__)
+
 template<typename T> inline void print(const T& val) {
   Serial.print(val);
 }